@@ -0,0 +1,117 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "arena.h"
+
+#include <stdlib.h>
+
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGN 16
+#define ARENA_KEEP_SIZE (8 << 20)
+
+static inline size_t
+alignSize(size_t size)
+{
+	return (size + ARENA_ALIGN - 1) & ~static_cast<size_t>(ARENA_ALIGN - 1);
+}
+
+Arena::Arena()
+	: chunk_(nullptr),
+	  used_(0),
+	  total_(0)
+{
+}
+
+Arena::~Arena()
+{
+	freeChunks();
+}
+
+Arena::Chunk *
+Arena::newChunk(size_t size, Chunk *next)
+{
+	Chunk *chunk = static_cast<Chunk *>(malloc(alignSize(sizeof(Chunk)) + size));
+	if(!chunk)
+		throw std::bad_alloc();
+	chunk->next = next;
+	chunk->size = size;
+	total_ += size;
+	return chunk;
+}
+
+void
+Arena::freeChunks()
+{
+	while(chunk_) {
+		Chunk *next = chunk_->next;
+		free(chunk_);
+		chunk_ = next;
+	}
+	total_ = 0;
+}
+
+void *
+Arena::allocate(size_t size)
+{
+	size = alignSize(size);
+	if(!chunk_ || used_ + size > chunk_->size) {
+		size_t chunkSize = chunk_ ? chunk_->size * 2 : ARENA_CHUNK_SIZE;
+		while(chunkSize < size)
+			chunkSize *= 2;
+		chunk_ = newChunk(chunkSize, chunk_);
+		used_ = 0;
+	}
+
+	void *p = reinterpret_cast<char *>(chunk_) + alignSize(sizeof(Chunk)) + used_;
+	used_ += size;
+	return p;
+}
+
+/*!
+ * \brief Release all allocations, up to ARENA_KEEP_SIZE of memory is kept for next hunk.
+ */
+void
+Arena::reset()
+{
+	if(total_ > ARENA_KEEP_SIZE) {
+		freeChunks();
+		chunk_ = newChunk(ARENA_CHUNK_SIZE, nullptr);
+	} else if(chunk_ && chunk_->next) {
+		const size_t total = total_;
+		freeChunks();
+		chunk_ = newChunk(total, nullptr);
+	}
+	used_ = 0;
+}
+
+/*!
+ * \brief Release allocations made after \p mark, chunks added since then are freed.
+ */
+void
+Arena::rewind(const Mark &mark)
+{
+	while(chunk_ != mark.chunk) {
+		Chunk *next = chunk_->next;
+		total_ -= chunk_->size;
+		free(chunk_);
+		chunk_ = next;
+	}
+	used_ = mark.used;
+}
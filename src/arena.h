@@ -0,0 +1,110 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/*!
+ * \brief Bump allocator for memory used while matching single hunk.
+ * Nothing is freed until reset(), which releases everything at once. When more than one chunk was
+ * needed reset() replaces them with a single chunk of their total size, so after few hunks all
+ * allocations come from one chunk. Memory of unusually big hunks is not kept, past ARENA_KEEP_SIZE
+ * reset() goes back to one chunk of initial size. Temporary memory can be released earlier with rewind() to a mark().
+ */
+class Arena
+{
+	struct Chunk;
+
+public:
+	Arena();
+	~Arena();
+
+	void *allocate(size_t size);
+	void reset();
+
+	struct Mark {
+		Chunk *chunk;
+		size_t used;
+	};
+
+	inline Mark mark() const { return Mark{chunk_, used_}; }
+	void rewind(const Mark &mark);
+	inline size_t size() const { return total_; }
+
+private:
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	struct Chunk {
+		Chunk *next;
+		size_t size;
+	};
+
+	Chunk *newChunk(size_t size, Chunk *next);
+	void freeChunks();
+
+	Chunk *chunk_;
+	size_t used_;
+	size_t total_;
+};
+
+/*!
+ * \brief STL allocator taking memory from Arena, or from heap when there is no arena.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(Arena *arena = nullptr) : arena_(arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena_) {}
+
+	inline T *allocate(size_t n)
+	{
+		if(arena_)
+			return static_cast<T *>(arena_->allocate(n * sizeof(T)));
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	inline void deallocate(T *p, size_t)
+	{
+		if(!arena_)
+			::operator delete(p);
+	}
+
+	template<typename U>
+	inline bool operator==(const ArenaAllocator<U> &other) const { return arena_ == other.arena_; }
+	template<typename U>
+	inline bool operator!=(const ArenaAllocator<U> &other) const { return arena_ != other.arena_; }
+
+	Arena *arena_;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/*!
+ * \brief Releases arena memory allocated during its lifetime, does nothing without arena.
+ */
+class ArenaScope
+{
+public:
+	ArenaScope(Arena *arena) : arena_(arena), mark_(arena ? arena->mark() : Arena::Mark{nullptr, 0}) {}
+	~ArenaScope()
+	{
+		if(arena_)
+			arena_->rewind(mark_);
+	}
+
+private:
+	ArenaScope(const ArenaScope &) = delete;
+	ArenaScope &operator=(const ArenaScope &) = delete;
+
+	Arena *arena_;
+	const Arena::Mark mark_;
+};
+
+#endif // ARENA_H
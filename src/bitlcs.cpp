@@ -0,0 +1,92 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "bitlcs.h"
+
+#include <cassert>
+
+/*!
+ * \brief Append runs of longest common subsequence of \p rem and \p add to \p list.
+ * Each '+' character updates a bit vector of '-' rows (Hyyrö), where zero bits mark rows at which
+ * LCS grows. Vectors of all columns are kept for traceback, so this is meant for small blocks only.
+ */
+void
+BitLcs::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	assert(rem <= remEnd);
+	assert(add <= addEnd);
+
+	const int remLen = remEnd - rem;
+	const int addLen = addEnd - add;
+	const int words = (remLen + 63) / 64;
+	if(!words || !addLen)
+		return;
+
+	// bit i of mask of character is set when rem[i] is that character
+	masks_.assign(256 * words, 0);
+	for(int i = 0; i < remLen; i++)
+		masks_[static_cast<unsigned char>(rem[i]) * words + i / 64] |= uint64_t(1) << (i % 64);
+
+	// column 0 is state before first '+' character, no rows are matched
+	columns_.resize((addLen + 1) * words);
+	for(int w = 0; w < words; w++)
+		columns_[w] = ~uint64_t(0);
+
+	for(int j = 0; j < addLen; j++) {
+		const uint64_t *mask = &masks_[static_cast<unsigned char>(add[j]) * words];
+		const uint64_t *prev = &columns_[j * words];
+		uint64_t *cur = &columns_[(j + 1) * words];
+		uint64_t carry = 0;
+		for(int w = 0; w < words; w++) {
+			const uint64_t v = prev[w];
+			const uint64_t u = v & mask[w];
+			const uint64_t sum = v + u;
+			const uint64_t total = sum + carry;
+			carry = (sum < v) | (total < sum);
+			cur[w] = total | (v & ~mask[w]);
+		}
+	}
+
+	// trace back from the end, equal characters are always on some longest path
+	runs_.clear();
+	int i = remLen - 1;
+	int j = addLen - 1;
+	while(i >= 0 && j >= 0) {
+		if(rem[i] == add[j]) {
+			if(!runs_.empty() && runs_.back().rem_ == rem + i + 1 && runs_.back().add_ == add + j + 1) {
+				runs_.back().rem_--;
+				runs_.back().add_--;
+				runs_.back().len_++;
+			} else {
+				runs_.push_back(Match(rem + i, rem + i + 1, add + j, add + j + 1, 1));
+			}
+			i--;
+			j--;
+		} else if((columns_[(j + 1) * words + i / 64] >> (i % 64)) & 1) {
+			// row i doesn't grow LCS in this column
+			i--;
+		} else {
+			j--;
+		}
+	}
+
+	for(auto it = runs_.rbegin(); it != runs_.rend(); ++it)
+		list.push_back(*it);
+}
@@ -0,0 +1,23 @@
+#ifndef BITLCS_H
+#define BITLCS_H
+
+#include "match.h"
+
+#include <stdint.h>
+#include <vector>
+
+/*!
+ * \brief Bit-parallel longest common subsequence of small blocks, one 64 bit word per 64 '-' characters.
+ */
+class BitLcs
+{
+public:
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+private:
+	std::vector<uint64_t> masks_;
+	std::vector<uint64_t> columns_;
+	std::vector<Match> runs_;
+};
+
+#endif // BITLCS_H
@@ -0,0 +1,96 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "blocksketch.h"
+#include "qgramindex.h"
+
+#include <algorithm>
+
+/*!
+ * \brief Sketch \p rem and \p add blocks, similarity() and containment() will estimate how alike they are.
+ * Blocks shorter than q-gram have nothing in common.
+ */
+void
+BlockSketch::compare(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	common_ = remCount_ = addCount_ = 0;
+	if(remEnd - rem < QGRAM_SIZE || addEnd - add < QGRAM_SIZE)
+		return;
+
+	const int grams = std::max(remEnd - rem, addEnd - add) - QGRAM_SIZE + 1;
+	sampleShift_ = 0;
+	while(grams >> sampleShift_ > SKETCH_MAX_GRAMS)
+		sampleShift_++;
+
+	// filter has about four bits per sampled q-gram, small blocks clear and compare only part of it
+	bitShift_ = 6;
+	while(bitShift_ < SKETCH_SHIFT && 1 << bitShift_ < 4 * (grams >> sampleShift_))
+		bitShift_++;
+	const int words = (1 << bitShift_) / 64;
+
+	fill(rem, remEnd, remBits_);
+	fill(add, addEnd, addBits_);
+
+	for(int i = 0; i < words; i++) {
+		common_ += __builtin_popcountll(remBits_[i] & addBits_[i]);
+		remCount_ += __builtin_popcountll(remBits_[i]);
+		addCount_ += __builtin_popcountll(addBits_[i]);
+	}
+}
+
+/*!
+ * \brief Share of sampled q-grams present in both blocks, relative to block with more of them.
+ */
+float
+BlockSketch::similarity() const
+{
+	const int count = std::max(remCount_, addCount_);
+	return count ? float(common_) / count : 0.f;
+}
+
+/*!
+ * \brief Share of sampled q-grams present in both blocks, relative to block with fewer of them.
+ * Low containment means that no part of either block was kept in the other one.
+ */
+float
+BlockSketch::containment() const
+{
+	const int count = std::min(remCount_, addCount_);
+	return count ? float(common_) / count : 0.f;
+}
+
+/*!
+ * \brief Set \p bits of sampled q-grams of \p block.
+ * Top bits of multiplicative hash decide whether q-gram is sampled, bits below them pick filter bit.
+ */
+void
+BlockSketch::fill(const char *block, const char *blockEnd, uint64_t *bits) const
+{
+	std::fill(bits, bits + (1 << bitShift_) / 64, 0);
+
+	const uint32_t sampleLimit = sampleShift_ ? 1u << (32 - sampleShift_) : 0;
+	for(const char *pos = block; pos + QGRAM_SIZE <= blockEnd; pos++) {
+		const uint32_t hash = QGramIndex::gram(pos) * 2654435761u;
+		if(sampleLimit && hash >= sampleLimit)
+			continue;
+		const uint32_t bit = (hash << sampleShift_) >> (32 - bitShift_);
+		bits[bit / 64] |= uint64_t(1) << (bit % 64);
+	}
+}
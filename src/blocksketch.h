@@ -0,0 +1,36 @@
+#ifndef BLOCKSKETCH_H
+#define BLOCKSKETCH_H
+
+#include <stdint.h>
+
+#define SKETCH_SHIFT 14
+#define SKETCH_BITS (1 << SKETCH_SHIFT)
+#define SKETCH_MAX_GRAMS 4096
+
+/*!
+ * \brief Cheap estimate of how similar two blocks are.
+ * Sampled q-grams of each block set bits of a filter, similarity is taken from bits set in both
+ * filters. Sample rate is picked so at most about SKETCH_MAX_GRAMS q-grams of bigger block are kept,
+ * q-gram is sampled by its hash so it is sampled in both blocks or in none.
+ */
+class BlockSketch
+{
+public:
+	void compare(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+
+	float similarity() const;
+	float containment() const;
+
+private:
+	void fill(const char *block, const char *blockEnd, uint64_t *bits) const;
+
+	int sampleShift_;
+	int bitShift_;
+	int common_;
+	int remCount_;
+	int addCount_;
+	uint64_t remBits_[SKETCH_BITS / 64];
+	uint64_t addBits_[SKETCH_BITS / 64];
+};
+
+#endif // BLOCKSKETCH_H
@@ -0,0 +1,58 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "budget.h"
+
+#include <time.h>
+
+long
+monotonicMicroseconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+Budget::Budget()
+	: end_(0),
+	  exceeded_(false)
+{
+}
+
+/*!
+ * \brief Start budget of \p milliseconds, zero means unlimited time.
+ */
+void
+Budget::start(int milliseconds)
+{
+	exceeded_ = false;
+	end_ = milliseconds ? monotonicMicroseconds() + milliseconds * 1000L : 0;
+}
+
+/*!
+ * \brief Check whether budget is used up, once it is it stays that way until next start().
+ */
+bool
+Budget::exceeded()
+{
+	if(!exceeded_ && end_ && monotonicMicroseconds() >= end_)
+		exceeded_ = true;
+	return exceeded_;
+}
@@ -0,0 +1,27 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+// loops with cheap steps check time budget only after this many of them
+#define BUDGET_CHECK_STEPS 16
+
+long monotonicMicroseconds();
+
+/*!
+ * \brief Time budget (--budget) of block being matched.
+ * It is shared by matchers, once it is used up they stop and remaining parts of block are left unmatched.
+ */
+class Budget
+{
+public:
+	Budget();
+
+	void start(int milliseconds);
+	bool exceeded();
+	inline bool wasExceeded() const { return exceeded_; }
+
+private:
+	long end_;
+	bool exceeded_;
+};
+
+#endif // BUDGET_H
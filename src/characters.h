@@ -0,0 +1,13 @@
+#ifndef CHARACTERS_H
+#define CHARACTERS_H
+
+/*!
+ * \brief White-space skipped by --ignore-spaces.
+ */
+static inline bool
+isSpace(const char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\n';
+}
+
+#endif // CHARACTERS_H
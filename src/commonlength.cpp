@@ -0,0 +1,100 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "commonlength.h"
+
+#ifdef COMMONLENGTH_X86
+#include <immintrin.h>
+#endif
+
+int
+commonLengthScalar(const char *a, const char *b, int maxLen)
+{
+	int len = 0;
+	while(len < maxLen && a[len] == b[len])
+		len++;
+	return len;
+}
+
+#ifdef COMMONLENGTH_X86
+bool
+cpuHasAvx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("sse2"))) int
+commonLengthSse2(const char *a, const char *b, int maxLen)
+{
+	int len = 0;
+	// most matches end within first few bytes, don't load vectors for them
+	while(len < maxLen && len < 4) {
+		if(a[len] != b[len])
+			return len;
+		len++;
+	}
+	while(len + 16 <= maxLen) {
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + len));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + len));
+		const unsigned diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xffff;
+		if(diff)
+			return len + __builtin_ctz(diff);
+		len += 16;
+	}
+	while(len < maxLen && a[len] == b[len])
+		len++;
+	return len;
+}
+
+__attribute__((target("avx2"))) int
+commonLengthAvx2(const char *a, const char *b, int maxLen)
+{
+	int len = 0;
+	while(len < maxLen && len < 4) {
+		if(a[len] != b[len])
+			return len;
+		len++;
+	}
+	while(len + 32 <= maxLen) {
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + len));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + len));
+		const unsigned diff = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+		if(diff)
+			return len + __builtin_ctz(diff);
+		len += 32;
+	}
+	return len + commonLengthSse2(a + len, b + len, maxLen - len);
+}
+#endif
+
+static CommonLengthFunc
+selectCommonLength()
+{
+#ifdef COMMONLENGTH_X86
+	if(cpuHasAvx2())
+		return commonLengthAvx2;
+	return commonLengthSse2;
+#else
+	return commonLengthScalar;
+#endif
+}
+
+const CommonLengthFunc commonLength = selectCommonLength();
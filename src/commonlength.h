@@ -0,0 +1,23 @@
+#ifndef COMMONLENGTH_H
+#define COMMONLENGTH_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COMMONLENGTH_X86
+#endif
+
+typedef int (*CommonLengthFunc)(const char *a, const char *b, int maxLen);
+
+/*!
+ * \brief Number of equal leading bytes of \p a and \p b, at most \p maxLen.
+ * Best implementation for running CPU (AVX2, SSE2 or scalar) is selected at startup.
+ */
+extern const CommonLengthFunc commonLength;
+
+int commonLengthScalar(const char *a, const char *b, int maxLen);
+#ifdef COMMONLENGTH_X86
+int commonLengthSse2(const char *a, const char *b, int maxLen);
+int commonLengthAvx2(const char *a, const char *b, int maxLen);
+bool cpuHasAvx2();
+#endif
+
+#endif // COMMONLENGTH_H
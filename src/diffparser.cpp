@@ -21,9 +21,17 @@
 #include "diffparser.h"
 
 #include "neonapp.h"
+#include "characters.h"
 #include "colors.h"
+#include "commonlength.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <algorithm>
 #include <cassert>
 
@@ -31,48 +39,28 @@
 #define BUFFER_SIZE_INIT 8192
 // when buffer becomes too small its size is doubled, unless bigger than this
 #define BUFFER_MAX_SIZE_INC 8192 * 1024
-
-Match::Match()
-	: rem_(nullptr),
-	  remEnd_(nullptr),
-	  add_(nullptr),
-	  addEnd_(nullptr),
-	  len_(0)
+// input is read in chunks of this size, chunk buffer grows only for longer lines
+#define INPUT_CHUNK_SIZE 65536
+// blocks up to this size are compared with bit-parallel LCS instead of myers
+#define BIT_PARALLEL_MAX_SIZE 1024
+// --engine=auto uses bit-parallel LCS on blocks at least this similar
+#define AUTO_LCS_MIN_SIMILARITY 0.7f
+// blocks with both sides at least this big are not matched when they have less in common
+#define UNRELATED_MIN_SIZE 64
+#define UNRELATED_MAX_CONTAINMENT 0.1f
+// --reparse-range blocks are split on runs of this many context lines
+#define CONTEXT_ANCHOR_MIN_LINES 4
+// blocks of this size are split on lines unique to both of them before matching
+#define ANCHOR_MIN_SIZE 2048
+// smaller '+' blocks are searched without q-gram index
+#define QGRAM_INDEX_MIN_SIZE 64
+
+static inline bool
+isUtf8Continuation(const char ch)
 {
+	return (ch & 0xC0) == 0x80;
 }
 
-Match::Match(const char *rem, const char *remEnd, const char *add, const char *addEnd, int len)
-	: rem_(rem),
-	  remEnd_(remEnd),
-	  add_(add),
-	  addEnd_(addEnd),
-	  len_(len)
-{
-}
-
-
-HalfMatch::HalfMatch()
-	: rem_(nullptr),
-	  remEnd_(nullptr),
-	  len_(0)
-{
-}
-
-HalfMatch::HalfMatch(const Match &match)
-	: rem_(match.rem_),
-	  remEnd_(match.remEnd_),
-	  len_(match.remEnd_ - match.rem_)
-{
-}
-
-HalfMatch::HalfMatch(const char *rem, const char *remEnd, int len)
-	: rem_(rem),
-	  remEnd_(remEnd),
-	  len_(len)
-{
-}
-
-
 const DiffParser::LineHandler DiffParser::lineHandler_[LINE_HANDLER_SIZE] = {
 	// diff header lines
 	{"---", &DiffParser::handleFileInfoLine, false},
@@ -86,6 +74,13 @@ const DiffParser::LineHandler DiffParser::lineHandler_[LINE_HANDLER_SIZE] = {
 
 DiffParser::DiffParser(FILE *inputStream)
 	: input_(inputStream),
+	  inputFd_(inputStream ? fileno(inputStream) : -1),
+	  in_(nullptr),
+	  inPos_(0),
+	  inLen_(0),
+	  inSize_(INPUT_CHUNK_SIZE),
+	  inEof_(false),
+	  inMapped_(false),
 	  buf_(nullptr),
 	  bufLen_(0),
 	  bufSize_(BUFFER_SIZE_INIT),
@@ -97,14 +92,51 @@ DiffParser::DiffParser(FILE *inputStream)
 	  blockRem_(nullptr),
 	  blockRemEnd_(nullptr),
 	  blockAdd_(nullptr),
-	  blockAddEnd_(nullptr)
+	  blockAddEnd_(nullptr),
+	  engineStats_(),
+	  selectTime_(0),
+	  overBudgetBlocks_(0),
+	  unrelatedBlocks_(0),
+	  lineBlocks_(0),
+	  automaton_(&budget_),
+	  suffixArray_(&arena_, &budget_),
+	  myers_(&budget_),
+	  lineAnchors_(&arena_),
+	  tokenMatcher_(&arena_, &budget_)
 {
-	buf_ = static_cast<char *>(malloc(bufSize_));
+	// regular files are mapped to memory, lines and blocks will point directly into mapping
+	struct stat st;
+	if(inputFd_ != -1 && fstat(inputFd_, &st) == 0 && S_ISREG(st.st_mode)
+		&& st.st_size > 0 && st.st_size <= INT_MAX) {
+		void *map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, inputFd_, 0);
+		if(map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			const off_t offset = lseek(inputFd_, 0, SEEK_CUR);
+			in_ = static_cast<char *>(map);
+			inSize_ = inLen_ = st.st_size;
+			inPos_ = offset > 0 && offset < st.st_size ? offset : 0;
+			inEof_ = inMapped_ = true;
+		}
+	}
+
+	if(!inMapped_) {
+		in_ = static_cast<char *>(malloc(inSize_));
+		buf_ = static_cast<char *>(malloc(bufSize_));
+	}
 	alt_ = static_cast<char *>(malloc(altSize_));
 }
 
 DiffParser::~DiffParser()
 {
+	if(inMapped_) {
+		munmap(in_, inSize_);
+		in_ = buf_ = nullptr;
+		inSize_ = inLen_ = inPos_ = 0;
+	}
+	if(in_) {
+		free(in_);
+		inSize_ = inLen_ = inPos_ = 0;
+	}
 	if(buf_) {
 		free(buf_);
 		bufSize_ = bufLen_ = 0;
@@ -165,6 +197,9 @@ DiffParser::processInput()
 
 	if(inBlock_)
 		processBlock();
+
+	if(app->stats())
+		printStats();
 }
 
 void
@@ -172,315 +207,767 @@ DiffParser::resetBuffers()
 {
 	bufLen_ = 0;
 	altLen_ = 0;
-	line_ = nullptr;
-	lineLen_ = 0;
 	blockRem_ = nullptr;
 	blockRemEnd_ = nullptr;
 	blockAdd_ = nullptr;
 	blockAddEnd_ = nullptr;
+	contextLines_.clear();
 }
 
 void
-DiffParser::resizeBuffers()
+DiffParser::resizeBuffers(int bufNeeded, int altNeeded)
 {
-	if(bufLen_ * 4 / 3 > bufSize_) {
-		const char *buf = buf_;
-		bufSize_ += bufSize_ > BUFFER_MAX_SIZE_INC ? BUFFER_MAX_SIZE_INC : bufSize_;
+	// mapped input is compacted in place and never grows
+	if(!inMapped_ && bufLen_ + bufNeeded > bufSize_) {
+		// remember block offsets, pointers can't be used after realloc
+		const bool remInBuf = blockRem_;
+		const bool addInBuf = blockAdd_ && !app->reparseRange();
+		const int remOffset = remInBuf ? blockRem_ - buf_ : 0;
+		const int remEndOffset = remInBuf ? blockRemEnd_ - buf_ : 0;
+		const int addOffset = addInBuf ? blockAdd_ - buf_ : 0;
+		const int addEndOffset = addInBuf ? blockAddEnd_ - buf_ : 0;
+
+		while(bufLen_ + bufNeeded > bufSize_)
+			bufSize_ += bufSize_ > BUFFER_MAX_SIZE_INC ? BUFFER_MAX_SIZE_INC : bufSize_;
 		buf_ = static_cast<char *>(realloc(buf_, bufSize_));
 
 		// change pointers to new buf address
-		line_ = buf_ + (line_ - buf);
-		if(blockRem_) {
-			blockRem_ = buf_ + (blockRem_ - buf);
-			blockRemEnd_ = buf_ + (blockRemEnd_ - buf);
+		if(remInBuf) {
+			blockRem_ = buf_ + remOffset;
+			blockRemEnd_ = buf_ + remEndOffset;
 		}
-		if(blockAdd_ && !app->reparseRange()) {
-			blockAdd_ = buf_ + (blockAdd_ - buf);
-			blockAddEnd_ = buf_ + (blockAddEnd_ - buf);
+		if(addInBuf) {
+			blockAdd_ = buf_ + addOffset;
+			blockAddEnd_ = buf_ + addEndOffset;
 		}
 	}
-	if(altLen_ * 4 / 3 > altSize_) {
-		const char *alt = alt_;
-		altSize_ += altSize_ > BUFFER_MAX_SIZE_INC ? BUFFER_MAX_SIZE_INC : altSize_;
+	if(altLen_ + altNeeded > altSize_) {
+		const bool addInAlt = blockAdd_ && app->reparseRange();
+		const int addOffset = addInAlt ? blockAdd_ - alt_ : 0;
+		const int addEndOffset = addInAlt ? blockAddEnd_ - alt_ : 0;
+
+		while(altLen_ + altNeeded > altSize_)
+			altSize_ += altSize_ > BUFFER_MAX_SIZE_INC ? BUFFER_MAX_SIZE_INC : altSize_;
 		alt_ = static_cast<char *>(realloc(alt_, altSize_));
 
 		// change pointers to new alt address
-		if(blockAdd_ && app->reparseRange()) {
-			blockAdd_ = alt_ + (blockAdd_ - alt);
-			blockAddEnd_ = alt_ + (blockAddEnd_ - alt);
+		if(addInAlt) {
+			blockAdd_ = alt_ + addOffset;
+			blockAddEnd_ = alt_ + addEndOffset;
 		}
 	}
 }
 
+/*!
+ * \brief Read next chunk of input after the unread part of input buffer.
+ * \return false when there is no more input
+ */
 bool
-DiffParser::readLine()
+DiffParser::fillInput()
 {
-	line_ = &buf_[bufLen_];
-	lineLen_ = 0;
-
-	while(!feof(input_)) {
-		if(bufLen_ >= bufSize_)
-			resizeBuffers();
-
-		int ch = fgetc(input_);
-		buf_[bufLen_] = ch;
+	if(inEof_)
+		return false;
+
+	// move unread data to start of buffer, grow it if single line doesn't fit
+	if(inPos_) {
+		memmove(in_, in_ + inPos_, inLen_ - inPos_);
+		inLen_ -= inPos_;
+		inPos_ = 0;
+	}
+	if(inLen_ == inSize_) {
+		inSize_ *= 2;
+		in_ = static_cast<char *>(realloc(in_, inSize_));
+	}
 
-		bufLen_++;
-		lineLen_++;
+	for(;;) {
+		const ssize_t n = read(inputFd_, in_ + inLen_, inSize_ - inLen_);
+		if(n > 0) {
+			inLen_ += n;
+			return true;
+		}
+		if(n == -1 && errno == EINTR)
+			continue;
+		inEof_ = true;
+		return false;
+	}
+}
 
-		if(ch == '\n')
+/*!
+ * \brief Point line_ to next line in input buffer. Line is not copied, it stays valid until next call.
+ * \return false when there are no more lines
+ */
+bool
+DiffParser::readLine()
+{
+	const char *lineEnd;
+	while(!(lineEnd = static_cast<const char *>(memchr(in_ + inPos_, '\n', inLen_ - inPos_)))) {
+		if(!fillInput()) {
+			// last line without newline
+			lineEnd = in_ + inLen_ - 1;
 			break;
+		}
 	}
 
-	return !feof(input_);
+	line_ = in_ + inPos_;
+	lineLen_ = lineEnd + 1 - line_;
+	inPos_ += lineLen_;
+
+	return lineLen_ > 0;
 }
 
+/*!
+ * \brief Append current line to block buffer without ansi sequences and first \p stripIndent characters.
+ * Mapped input is compacted in place, so blocks point directly into the mapping.
+ * \param stripIndent how many leading characters to drop
+ * \param writeToAlt copy line to alt buffer instead
+ * \param moveToAlt line is only kept in alt buffer
+ */
 void
 DiffParser::stripLineAnsi(int stripIndent/* = 0 */, bool writeToAlt/* = false*/, bool moveToAlt/* = false*/)
 {
-	if(writeToAlt && altLen_ + lineLen_ < altSize_)
-		resizeBuffers();
+	if(inMapped_ && !bufLen_ && !writeToAlt)
+		buf_ = line_; // block starts at this line in mapped input
+	resizeBuffers(writeToAlt ? 0 : lineLen_, writeToAlt ? lineLen_ : 0);
 
-	char *left = writeToAlt ? &alt_[altLen_] : line_;
-	char *right = line_;
+	char *left = writeToAlt ? &alt_[altLen_] : &buf_[bufLen_];
+	const char *right = line_;
+	const char *lineEnd = line_ + lineLen_;
 
-	for(int i = 0; i < lineLen_;) {
+	while(right < lineEnd) {
 		if(*right == '\33') { // skip ansi chars
-			do {
-				lineLen_--;
-				bufLen_--;
-			} while(i < lineLen_ && *right++ != 'm');
+			while(right < lineEnd && *right++ != 'm');
 			continue;
 		}
 		if(stripIndent) {
-			lineLen_--;
-			bufLen_--;
 			stripIndent--;
 			right++;
-		} else {
-			i++;
-			*left++ = *right++;
+			continue;
 		}
+		const char *ansi = static_cast<const char *>(memchr(right, '\33', lineEnd - right));
+		const int len = (ansi ? ansi : lineEnd) - right;
+		memmove(left, right, len);
+		left += len;
+		right += len;
 	}
 
 	if(writeToAlt) {
-		altLen_ += lineLen_;
+		const int len = left - &alt_[altLen_];
+		altLen_ += len;
 		if(moveToAlt) {
-			bufLen_ -= lineLen_;
+			line_ = &alt_[altLen_ - len];
 			lineLen_ = 0;
 		}
+	} else {
+		line_ = &buf_[bufLen_];
+		lineLen_ = left - line_;
+		bufLen_ += lineLen_;
 	}
 }
 
+/*!
+ * \brief Pick engine for --engine=auto by size and similarity of blocks.
+ * Bit-parallel LCS is several times faster than match cache on small blocks. On similar blocks
+ * common subsequence is made of same long runs that cache finds, on others it is scattered and
+ * cache is used. Suffix array and automaton are slower than cache on every kind of block.
+ */
+MatchEngine
+DiffParser::selectEngine(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	if(remEnd - rem <= BIT_PARALLEL_MAX_SIZE && addEnd - add <= BIT_PARALLEL_MAX_SIZE) {
+		sketch_.compare(rem, remEnd, add, addEnd);
+		if(sketch_.similarity() >= AUTO_LCS_MIN_SIMILARITY)
+			return engineMyers;
+	}
+
+	return engineCache;
+}
+
+/*!
+ * \brief Check whether \p rem and \p add blocks are rewritten completely.
+ * Matching such blocks finds only short accidental matches, so they are highlighted whole instead.
+ */
+bool
+DiffParser::unrelatedBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	if(remEnd - rem < UNRELATED_MIN_SIZE || addEnd - add < UNRELATED_MIN_SIZE)
+		return false;
+	sketch_.compare(rem, remEnd, add, addEnd);
+	if(sketch_.containment() >= UNRELATED_MAX_CONTAINMENT)
+		return false;
+
+	unrelatedBlocks_++;
+	return true;
+}
+
+/*!
+ * \brief Count block matched by \p matcher since \p start in statistics.
+ */
 void
-DiffParser::cacheClip(const char *rem, const char *remEnd)
-{
-	bool needsSort = false;
-	for(auto it = cache_.begin(), e = cache_.end(); it != e;) {
-		// it intersects clip
-		if(it->rem_ < remEnd && rem < it->remEnd_) {
-			const bool pieceBefore = it->rem_ < rem;
-			const bool pieceAfter = it->remEnd_ > remEnd;
-			if(!pieceBefore && !pieceAfter) {
-				// longest includes it
-				it = cache_.erase(it);
-			} else {
-				needsSort = true;
-				const char *itEnd = it->remEnd_;
-				if(pieceBefore) {
-					it->remEnd_ = rem;
-					it->len_ = rem - it->rem_;
-				}
-				if(pieceAfter) {
-					if(pieceBefore) {
-						++it;
-						cache_.insert(it, HalfMatch(remEnd, itEnd, itEnd - remEnd));
-					} else {
-						it->rem_ = remEnd;
-						it->len_ = itEnd - it->rem_;
-						++it;
-					}
-				} else {
-					++it;
-				}
-			}
-		} else {
-			++it;
-		}
+DiffParser::addStats(int matcher, const char *rem, const char *remEnd, const char *add, const char *addEnd, long start)
+{
+	EngineStats &stats = engineStats_[matcher];
+	stats.blocks++;
+	stats.bytes += (remEnd - rem) + (addEnd - add);
+	stats.time += monotonicMicroseconds() - start;
+}
+
+/*!
+ * \brief Print statistics of engines to stderr.
+ */
+void
+DiffParser::printStats()
+{
+	static const char *engineNames[statsSize] = { "cache", "automaton", "suffix-array", "myers", "bit-lcs", "token" };
+
+	fprintf(stderr, "%-14s %10s %12s %12s\n", "engine", "blocks", "bytes", "time [ms]");
+	for(int i = 0; i < statsSize; i++) {
+		const EngineStats &stats = engineStats_[i];
+		if(stats.blocks)
+			fprintf(stderr, "%-14s %10d %12ld %12.3f\n", engineNames[i], stats.blocks, stats.bytes, stats.time / 1000.);
 	}
-	if(needsSort) // TODO: [optimization] we could skip sort and insert/move elements in the loop above
-		cache_.sort();
+	if(app->matchEngine() == engineAuto)
+		fprintf(stderr, "%-14s %10s %12s %12.3f\n", "(selection)", "", "", selectTime_ / 1000.);
+	fprintf(stderr, "single-line blocks: %d\n", lineBlocks_);
+	fprintf(stderr, "unrelated blocks: %d\n", unrelatedBlocks_);
+	if(app->budget())
+		fprintf(stderr, "blocks over budget: %d\n", overBudgetBlocks_);
 }
 
+/*!
+ * \brief Find first match of cached \p entry in \p add block.
+ * When whole entry isn't found, longest partial match is taken, first one of them.
+ * Position of unclipped entry is checked first, \p add block is scanned only when it is out of range.
+ */
 Match
-DiffParser::longestMake(const char *rem, const char *remEnd, const char *add, const char *addEnd, const int len)
+DiffParser::longestMatch(const HalfMatch &entry, const char *add, const char *addEnd)
 {
-	Match longest(rem, remEnd, add, addEnd, len);
-	cacheClip(rem, remEnd);
-	return longest;
+	const int len = entry.remEnd_ - entry.rem_;
+	if(entry.add_ && entry.add_ >= add && entry.add_ + len <= addEnd)
+		return Match(entry.rem_, entry.remEnd_, entry.add_, entry.add_ + len, len);
+	const char *bestAdd = nullptr;
+	int bestLen = 0;
+	for(const char *pos = add; pos < addEnd; pos++) {
+		pos = static_cast<const char *>(memchr(pos, *entry.rem_, addEnd - pos));
+		if(!pos)
+			break;
+		const int common = commonLength(entry.rem_, pos, std::min<ptrdiff_t>(len, addEnd - pos));
+		if(common == len)
+			return Match(entry.rem_, entry.remEnd_, pos, pos + len, len);
+		if(common > bestLen) {
+			bestAdd = pos;
+			bestLen = common;
+		}
+	}
+	if(!bestAdd)
+		return Match();
+	return Match(entry.rem_, entry.rem_ + bestLen, bestAdd, bestAdd + bestLen, bestLen);
 }
 
-Match
-DiffParser::longestMatch(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+/*!
+ * \brief Length of common start of \p rem and \p pos, first characters have to be equal.
+ * Runs of repeated character are compared by their lengths, so only part after equal runs is scanned.
+ * \param remRun length of run at \p rem
+ */
+int
+DiffParser::runMatchLength(const char *rem, const char *remEnd, int remRun, const char *pos, const char *addEnd,
+		const char *add) const
+{
+	const int run = addRuns_[pos - add];
+	if(run != remRun)
+		return std::min(run, remRun);
+	return run + commonLength(rem + run, pos + run, std::min(remEnd - rem, addEnd - pos) - run);
+}
+
+/*!
+ * \brief Cache longest matches of each position of \p rem block, moving past found matches.
+ * Inside of a run of repeated '+' character only its first position and position where remaining run
+ * is as long as run at '-' position can give longer match than positions before them, others are skipped.
+ * Only runs of single repeated byte are skipped, repeated longer periods like "abab" or "\t  \t  " are still
+ * extended from every position.
+ */
+void
+DiffParser::buildMatchCache(const char *rem, const char *remEnd, const char *add, const char *addEnd)
 {
 	assert(rem <= remEnd);
 	assert(add <= addEnd);
 
-	auto spaceCount = [](const char *buf, const char *bufEnd) -> int {
-		int c = 0;
-		while(buf + c < bufEnd && (buf[c] == ' ' || buf[c] == '\t' || buf[c] == '\n'))
-			c++;
-		return c;
-	};
+	// addRuns_[i] is length of run of same characters starting at add[i]
+	const int addLen = addEnd - add;
+	addRuns_.resize(addLen);
+	for(int i = addLen - 1; i >= 0; i--)
+		addRuns_[i] = i + 1 < addLen && add[i] == add[i + 1] ? addRuns_[i + 1] + 1 : 1;
 
-	const char *addSave = add;
+	if(addLen >= QGRAM_INDEX_MIN_SIZE) {
+		buildIndexedMatchCache(rem, remEnd, add, addEnd);
+		return;
+	}
 
-	HalfMatchList::reverse_iterator r = cache_.rbegin();
-	while(r != cache_.rend()) {
+	for(int steps = 1; rem < remEnd; steps++) {
+		if(!(steps % BUDGET_CHECK_STEPS) && budget_.exceeded())
+			break;
 
-		// not overlapping
-		if(r->rem_ >= remEnd || rem >= r->remEnd_) {
-			++r;
-			continue;
-		}
+		int remRun = 1;
+		while(rem + remRun < remEnd && rem[remRun] == *rem)
+			remRun++;
 
-		// clip longest match to our range
-		const char *mRem = r->rem_ < rem ? rem : r->rem_;
-		const char *mRemEnd = r->remEnd_ > remEnd ? remEnd : r->remEnd_;
-		const int mLen = mRemEnd - mRem;
-
-		// we got longest match from the cache_ now find the first match
-		const int iOffset = app->ignoreSpaces() ? spaceCount(mRem, mRemEnd) : 0;
-
-		const char *bestAdd = nullptr;
-		int bestRemLen = 0;
-		while(add < addEnd) {
-			int i = iOffset;
-			const int jOffset = app->ignoreSpaces() ? spaceCount(add, addEnd) : 0;
-			int j = jOffset;
-			while(mRem + i < mRemEnd && add + j < addEnd && mRem[i] == add[j]) {
-				i++;
-				j++;
-				if(app->ignoreSpaces()) {
-					i += spaceCount(mRem + i, mRemEnd);
-					j += spaceCount(add + j, addEnd);
-				}
+		int iMax = 0;
+		auto extend = [&](const char *pos) {
+			const int len = runMatchLength(rem, remEnd, remRun, pos, addEnd, add);
+			if(len > iMax) {
+				cache_.add(rem, rem + len, pos, len);
+				iMax = len;
 			}
-
-			if(i == mLen) {
-				// found a full match
-				return longestMake(mRem, mRemEnd, add, add + j, mLen > j ? mLen : j);
-			} else if(i > iOffset && i > bestRemLen) {
-				// found a partial match
-				// TODO: be smarter with partial matches, this will save time (10.19sec => 6.20sec).
-				//       Instead of HalfMatch cache Match; clip both ranges in cacheClip.
-				//       Right now clipping is done anyways with bestAdd below, and we have bigger
-				//       loop complexity here. Also we would save time by going for add_ buffer
-				//       immediately when in range.
-				bestAdd = add;
-				bestRemLen = i;
+		};
+
+		for(const char *pos = add; pos < addEnd;) {
+			const int run = addRuns_[pos - add];
+			if(*pos == *rem) {
+				extend(pos);
+				if(run > remRun)
+					extend(pos + run - remRun);
 			}
-
-			add += jOffset + 1;
+			pos += run;
 		}
+		rem += iMax > 0 ? iMax : 1;
+	}
+}
 
-		add = addSave;
+/*!
+ * \brief Same cache as buildMatchCache() builds, '+' positions not sharing first character are never tried.
+ * Matches are added only when longer than previous ones, and matches shorter than QGRAM_SIZE can't follow
+ * first position sharing whole q-gram. So only positions with same first character before it are extended,
+ * followed by positions sharing the q-gram. Runs of repeated characters are skipped like in buildMatchCache().
+ */
+void
+DiffParser::buildIndexedMatchCache(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	qgrams_.build(add, addEnd);
+
+	for(int steps = 1; rem < remEnd; steps++) {
+		if(!(steps % BUDGET_CHECK_STEPS) && budget_.exceeded())
+			break;
+
+		int remRun = 1;
+		while(rem + remRun < remEnd && rem[remRun] == *rem)
+			remRun++;
 
-		if(bestAdd) {
-			r->remEnd_ = mRem + bestRemLen;
-			if(r == cache_.rbegin()) {
-				cache_.sort();
-				r = cache_.rbegin();
+		int iMax = 0;
+		// run containing last tried position, only its position with run as long as remRun is tried
+		const char *runEnd = add;
+		const char *runMatch = nullptr;
+		auto extend = [&](const char *pos) {
+			int len;
+			if(remRun == 1) {
+				// positions inside of '+' run match only their first character, nothing to skip
+				len = commonLength(rem, pos, std::min(remEnd - rem, addEnd - pos));
 			} else {
-				--r;
-				cache_.sort();
+				if(pos < runEnd && pos != runMatch)
+					return;
+				if(pos >= runEnd) {
+					const int run = addRuns_[pos - add];
+					runEnd = pos + run;
+					runMatch = run > remRun ? runEnd - remRun : nullptr;
+				}
+				len = runMatchLength(rem, remEnd, remRun, pos, addEnd, add);
 			}
+			if(len > iMax) {
+				cache_.add(rem, rem + len, pos, len);
+				iMax = len;
+			}
+		};
+
+		if(rem + QGRAM_SIZE <= remEnd) {
+			const uint32_t gram = QGramIndex::gram(rem);
+			const int first = qgrams_.firstGram(gram);
+			for(int pos = qgrams_.firstByte(*rem);
+					pos != -1 && (first == -1 || pos < first) && iMax < QGRAM_SIZE - 1;
+					pos = qgrams_.nextByte(pos))
+				extend(add + pos);
+			for(int pos = first; pos != -1; pos = qgrams_.nextGram(pos, gram))
+				extend(add + pos);
+		} else {
+			for(int pos = qgrams_.firstByte(*rem); pos != -1; pos = qgrams_.nextByte(pos))
+				extend(add + pos);
+		}
+
+		rem += iMax > 0 ? iMax : 1;
+	}
+}
+
+/*!
+ * \brief Append matches of \p rem and \p add blocks to \p list, longest cached match first.
+ * Ranges before and after each match are matched too. Every cache entry lies in one of the ranges, so
+ * longest entry of the cache is longest entry of its range, and ranges are matched all together.
+ */
+void
+DiffParser::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	// ranges still to be matched by their '-' start, entries of dropped ranges are not in any of them
+	RangeMap ranges{RangeMap::allocator_type(&arena_)};
+	ranges.emplace(rem, Match(rem, remEnd, add, addEnd, 0));
+	const size_t listStart = list.size();
+	for(int id = cache_.longest(); id != -1 && !budget_.exceeded(); id = cache_.longest()) {
+		const HalfMatch &entry = cache_[id];
+		RangeMap::iterator it = ranges.upper_bound(entry.rem_);
+		if(it == ranges.begin() || (--it)->second.remEnd_ <= entry.rem_) {
+			cache_.erase(id);
 			continue;
 		}
+		const Match range = it->second;
+		assert(entry.remEnd_ <= range.remEnd_);
 
-		r = decltype(r){ cache_.erase(std::next(r).base()) };
+		// entry is done, partially matched one is not clipped to piece after the match
+		const Match longest = longestMatch(entry, range.add_, range.addEnd_);
+		cache_.erase(id);
+		if(!longest.len_)
+			continue;
+		cache_.clip(longest.rem_, longest.remEnd_);
+		list.push_back(longest);
+
+		ranges.erase(it);
+		if(range.rem_ < longest.rem_ && range.add_ < longest.add_)
+			ranges.emplace(range.rem_, Match(range.rem_, longest.rem_, range.add_, longest.add_, 0));
+		if(longest.remEnd_ < range.remEnd_ && longest.addEnd_ < range.addEnd_)
+			ranges.emplace(longest.remEnd_, Match(longest.remEnd_, range.remEnd_, longest.addEnd_, range.addEnd_, 0));
 	}
 
-	return Match();
+	std::sort(list.begin() + listStart, list.end(), [](const Match &a, const Match &b) {
+		return a.rem_ < b.rem_;
+	});
 }
 
+/*!
+ * \brief Copy \p block without white-space to arena.
+ * \param map receives position in \p block of each copied character
+ * \return length of copy
+ */
+int
+DiffParser::compactSpaces(const char *block, const char *blockEnd, char *&compact, const char **&map)
+{
+	compact = static_cast<char *>(arena_.allocate(blockEnd - block));
+	map = static_cast<const char **>(arena_.allocate((blockEnd - block) * sizeof(const char *)));
+	int len = 0;
+	for(const char *ch = block; ch < blockEnd; ch++) {
+		if(isSpace(*ch))
+			continue;
+		compact[len] = *ch;
+		map[len++] = ch;
+	}
+	return len;
+}
 
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list, white-space is ignored.
+ * Blocks are matched without white-space, matches are mapped back to blocks and extended over white-space
+ * following them.
+ */
 void
-DiffParser::buildMatchCache(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+DiffParser::matchCompacted(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
 {
-	assert(rem <= remEnd);
-	assert(add <= addEnd);
-
-	auto spaceCount = [](const char *buf, const char *bufEnd) -> int {
-		int c = 0;
-		while(buf + c < bufEnd && (buf[c] == ' ' || buf[c] == '\t' || buf[c] == '\n'))
-			c++;
-		return c;
-	};
-
-	const char *bSave = add;
+	char *remText;
+	char *addText;
+	const char **remMap;
+	const char **addMap;
+	const int remLen = compactSpaces(rem, remEnd, remText, remMap);
+	const int addLen = compactSpaces(add, addEnd, addText, addMap);
+	if(!remLen || !addLen)
+		return;
 
-	while(rem < remEnd) {
-		int iMax = 0;
-		const int iOffset = app->ignoreSpaces() ? spaceCount(rem, remEnd) : 0;
-		while(add < addEnd) {
-			int i = iOffset;
-			const int jOffset = app->ignoreSpaces() ? spaceCount(add, addEnd) : 0;
-			int j = jOffset;
+	const int first = list.size();
+	matchEngine(remText, remText + remLen, addText, addText + addLen, list);
+
+	for(int i = first, n = list.size(); i < n; i++) {
+		Match &match = list[i];
+		match.rem_ = remMap[match.rem_ - remText];
+		match.remEnd_ = remMap[match.remEnd_ - remText - 1] + 1;
+		match.add_ = addMap[match.add_ - addText];
+		match.addEnd_ = addMap[match.addEnd_ - addText - 1] + 1;
+		if(i == first) {
+			while(match.rem_ > rem && isSpace(match.rem_[-1]))
+				match.rem_--;
+			while(match.add_ > add && isSpace(match.add_[-1]))
+				match.add_--;
+		}
+		while(match.remEnd_ < remEnd && isSpace(*match.remEnd_))
+			match.remEnd_++;
+		while(match.addEnd_ < addEnd && isSpace(*match.addEnd_))
+			match.addEnd_++;
+		match.len_ = match.remEnd_ - match.rem_;
+	}
+}
 
-			while(rem + i < remEnd && add + j < addEnd && rem[i] == add[j]) {
+/*!
+ * \brief Find common start of \p rem and \p add blocks, white-space is skipped when ignoring spaces.
+ */
+template<typename Policy>
+Match
+DiffParser::commonPrefix(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	const char *i = rem;
+	const char *j = add;
+	for(;;) {
+		if(Policy::ignoreSpaces) {
+			while(i < remEnd && isSpace(*i))
 				i++;
+			while(j < addEnd && isSpace(*j))
 				j++;
-			}
+		}
+		if(i == remEnd || j == addEnd || *i != *j)
+			break;
+		i++;
+		j++;
+	}
 
-			if(i > iOffset && i > iMax) {
-				if(app->ignoreSpaces()) {
-					i += spaceCount(rem + i, remEnd);
-					j += spaceCount(add + j, addEnd);
-				}
-				// add it to cache, but make sure it's not duplicate(, and not all spaces)
-				iMax = i;
-				cache_.push_back(HalfMatch(rem, rem + i, i));
-			}
+	// don't end match inside of multibyte character
+	while(i > rem && j > add
+		&& ((i < remEnd && isUtf8Continuation(*i)) || (j < addEnd && isUtf8Continuation(*j)))) {
+		i--;
+		j--;
+	}
+
+	return Match(rem, i, add, j, i - rem);
+}
 
-			add += jOffset + 1;
+/*!
+ * \brief Find common end of \p rem and \p add blocks, white-space is skipped when ignoring spaces.
+ */
+template<typename Policy>
+Match
+DiffParser::commonSuffix(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	const char *i = remEnd;
+	const char *j = addEnd;
+	for(;;) {
+		if(Policy::ignoreSpaces) {
+			while(i > rem && isSpace(i[-1]))
+				i--;
+			while(j > add && isSpace(j[-1]))
+				j--;
 		}
-		rem += iMax > 0 ? iMax : 1;
-		add = bSave;
+		if(i == rem || j == add || i[-1] != j[-1])
+			break;
+		i--;
+		j--;
+	}
+
+	// don't start match inside of multibyte character
+	while(i < remEnd && j < addEnd && (isUtf8Continuation(*i) || isUtf8Continuation(*j))) {
+		i++;
+		j++;
 	}
 
-	cache_.sort();
+	return Match(i, remEnd, j, addEnd, remEnd - i);
 }
 
-MatchList
-DiffParser::compareBlocks(const char *remStart, const char *remEnd, const char *addStart, const char *addEnd)
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list using selected engine.
+ */
+void
+DiffParser::matchEngine(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
 {
-	MatchList list;
-	Match longest = longestMatch(remStart, remEnd, addStart, addEnd);
-	if(longest.len_) {
-		if(remStart < longest.rem_ && addStart < longest.add_)
-			list = compareBlocks(remStart, longest.rem_, addStart, longest.add_);
-		list.push_back(longest);
+	const long start = app->stats() ? monotonicMicroseconds() : 0;
+	const MatchEngine engine = app->matchEngine() == engineAuto ? selectEngine(rem, remEnd, add, addEnd) : app->matchEngine();
+	const long selected = app->stats() ? monotonicMicroseconds() : 0;
+
+	int matcher = engine;
+	switch(engine) {
+	case engineAutomaton:
+		automaton_.compareBlocks(rem, remEnd, add, addEnd, list);
+		break;
+	case engineSuffixArray:
+		suffixArray_.compareBlocks(rem, remEnd, add, addEnd, list);
+		break;
+	case engineMyers:
+		if(remEnd - rem <= BIT_PARALLEL_MAX_SIZE && addEnd - add <= BIT_PARALLEL_MAX_SIZE) {
+			bitLcs_.compareBlocks(rem, remEnd, add, addEnd, list);
+			matcher = statsBitLcs;
+		} else {
+			myers_.compareBlocks(rem, remEnd, add, addEnd, list);
+		}
+		break;
+	case engineCache:
+	case engineAuto: // never returned by selectEngine()
+		buildMatchCache(rem, remEnd, add, addEnd);
+		compareBlocks(rem, remEnd, add, addEnd, list);
+		cache_.clear();
+		break;
+	}
+
+	if(app->stats()) {
+		addStats(matcher, rem, remEnd, add, addEnd, selected);
+		selectTime_ += selected - start;
+	}
+}
 
-		if(longest.remEnd_ < remEnd && longest.addEnd_ < addEnd) {
-			MatchList tail = compareBlocks(longest.remEnd_, remEnd, longest.addEnd_, addEnd);
-			list.insert(list.end(), tail.begin(), tail.end());
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list.
+ * Common prefix and suffix are trimmed first, so only differing middle part goes through the matcher.
+ */
+void
+DiffParser::matchTrimmed(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		MatchList &list)
+{
+	// trimming characters would split words, token matcher trims whole tokens itself
+	if(app->wordDiff()) {
+		if(!budget_.exceeded() && !unrelatedBlocks(rem, remEnd, add, addEnd)) {
+			const long start = app->stats() ? monotonicMicroseconds() : 0;
+			tokenMatcher_.compareBlocks(rem, remEnd, add, addEnd, ignoreSpaces, list);
+			if(app->stats())
+				addStats(statsToken, rem, remEnd, add, addEnd, start);
 		}
+		return;
+	}
+
+	const Match head = ignoreSpaces ? commonPrefix<MatchPolicy<true>>(rem, remEnd, add, addEnd)
+			: commonPrefix<MatchPolicy<false>>(rem, remEnd, add, addEnd);
+	const Match tail = ignoreSpaces ? commonSuffix<MatchPolicy<true>>(head.remEnd_, remEnd, head.addEnd_, addEnd)
+			: commonSuffix<MatchPolicy<false>>(head.remEnd_, remEnd, head.addEnd_, addEnd);
+
+	if(head.len_)
+		list.push_back(head);
+
+	if(head.remEnd_ < tail.rem_ && head.addEnd_ < tail.add_ && !budget_.exceeded()
+			&& !unrelatedBlocks(head.remEnd_, tail.rem_, head.addEnd_, tail.add_)) {
+		if(ignoreSpaces)
+			matchCompacted(head.remEnd_, tail.rem_, head.addEnd_, tail.add_, list);
+		else
+			matchEngine(head.remEnd_, tail.rem_, head.addEnd_, tail.add_, list);
+	}
+
+	if(tail.len_)
+		list.push_back(tail);
+}
+
+/*!
+ * \brief Append matching parts of single '-' line \p rem and single '+' line \p add to \p list.
+ * Short lines are matched by LineMatcher on the stack, without going through matchBlocks(). It is only
+ * used where it gives same matches, with cache engine and without options that change matching.
+ * \return false when lines are not matched
+ */
+bool
+DiffParser::matchLine(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	if(app->matchEngine() != engineCache || app->ignoreSpaces() || app->alignLines() || app->wordDiff()
+			|| app->budget() || rem == remEnd || add == addEnd
+			|| remEnd - rem > LINE_MATCHER_MAX_SIZE || addEnd - add > LINE_MATCHER_MAX_SIZE
+			|| memchr(rem, '\n', remEnd - rem - 1) || memchr(add, '\n', addEnd - add - 1))
+		return false;
+
+	const size_t listSize = list.size();
+	const Match head = commonPrefix<MatchPolicy<false>>(rem, remEnd, add, addEnd);
+	const Match tail = commonSuffix<MatchPolicy<false>>(head.remEnd_, remEnd, head.addEnd_, addEnd);
+
+	if(head.len_)
+		list.push_back(head);
+
+	if(head.remEnd_ < tail.rem_ && head.addEnd_ < tail.add_
+			&& !unrelatedBlocks(head.remEnd_, tail.rem_, head.addEnd_, tail.add_)
+			&& !LineMatcher::compareBlocks(head.remEnd_, tail.rem_, head.addEnd_, tail.add_, list)) {
+		list.resize(listSize);
+		return false;
 	}
 
-	return list;
+	if(tail.len_)
+		list.push_back(tail);
+
+	lineBlocks_++;
+	return true;
 }
 
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list.
+ * With --align-lines each line is paired with most similar line first and matched only against it.
+ */
 void
-DiffParser::printBlock(const char id, const char *block, const char *blockEnd)
+DiffParser::matchAligned(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		MatchList &list)
+{
+	if(!app->alignLines() || !lineAlignment_.align(rem, remEnd, add, addEnd, ignoreSpaces, linePairs_)) {
+		matchTrimmed(rem, remEnd, add, addEnd, ignoreSpaces, list);
+		return;
+	}
+
+	for(const Match &pair : linePairs_)
+		matchTrimmed(pair.rem_, pair.remEnd_, pair.add_, pair.addEnd_, ignoreSpaces, list);
+}
+
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list.
+ * Lines that are unique in both blocks are matched first, parts between them are matched separately.
+ */
+void
+DiffParser::matchAnchored(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		MatchList &list)
+{
+	lineAnchors_.find(rem, remEnd, add, addEnd, ignoreSpaces, anchors_);
+
+	for(const Match &anchor : anchors_) {
+		if(rem < anchor.rem_ && add < anchor.add_)
+			matchAligned(rem, anchor.rem_, add, anchor.add_, ignoreSpaces, list);
+		list.push_back(anchor);
+		rem = anchor.remEnd_;
+		add = anchor.addEnd_;
+	}
+
+	if(rem < remEnd && add < addEnd)
+		matchAligned(rem, remEnd, add, addEnd, ignoreSpaces, list);
+}
+
+/*!
+ * \brief Append matching parts of \p rem and \p add blocks to \p list.
+ * With --reparse-range context lines are same lines of both blocks. Longer runs of them are taken as matches
+ * and only parts between them are matched, shorter ones are matched with the rest so changes can be matched
+ * across them. Longer runs are not stored in '+' block, their matches are empty on '+' side.
+ */
+void
+DiffParser::matchContext(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		MatchList &list)
+{
+	const char *remStart = rem;
+	const char *addStart = add;
+	for(const ContextLines &context : contextLines_) {
+		if(context.lines < CONTEXT_ANCHOR_MIN_LINES)
+			continue;
+		if(rem < remStart + context.rem && add < addStart + context.add)
+			matchBlocks(rem, remStart + context.rem, add, addStart + context.add, ignoreSpaces, list);
+		list.push_back(Match(remStart + context.rem, remStart + context.remEnd, addStart + context.add,
+				addStart + context.addEnd, context.remEnd - context.rem));
+		rem = remStart + context.remEnd;
+		add = addStart + context.addEnd;
+	}
+
+	if(rem < remEnd && add < addEnd)
+		matchBlocks(rem, remEnd, add, addEnd, ignoreSpaces, list);
+}
+
+/*!
+ * \brief Find matching parts of \p rem and \p add blocks.
+ */
+void
+DiffParser::matchBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		MatchList &list)
+{
+	if((remEnd - rem) + (addEnd - add) >= ANCHOR_MIN_SIZE)
+		matchAnchored(rem, remEnd, add, addEnd, ignoreSpaces, list);
+	else
+		matchAligned(rem, remEnd, add, addEnd, ignoreSpaces, list);
+}
+
+/*!
+ * \brief Print part of block, \p id is printed before each line, \p newLine tells whether part starts a line.
+ * Parts don't have to be contiguous in memory, long context runs are printed from the other block.
+ * \return whether next part starts a line
+ */
+bool
+DiffParser::printBlock(const char id, const char *block, const char *blockEnd, bool newLine)
 {
-	bool newLine = block == buf_ || block == alt_ || *(block - 1) == '\n';
 	while(block < blockEnd) {
 		if(newLine)
 			app->printChar(id);
 		newLine = *block == '\n';
 		app->printChar(*block++);
 	}
+	return newLine;
 }
 
 void
@@ -488,44 +975,62 @@ DiffParser::processBlock()
 {
 	inBlock_ = false;
 
+	if(app->reparseRange())
+		closeContextLines();
+
 	if(!blockAdd_) {
 		app->setColor(colorLineDel);
-		printBlock('-', blockRem_, blockRemEnd_);
+		printBlock('-', blockRem_, blockRemEnd_, true);
 		return;
 	}
 	if(!blockRem_) {
 		app->setColor(colorLineAdd);
-		printBlock('+', blockAdd_, blockAddEnd_);
+		printBlock('+', blockAdd_, blockAddEnd_, true);
 		return;
 	}
 
-	buildMatchCache(blockRem_, blockRemEnd_, blockAdd_, blockAddEnd_);
-	MatchList blocks = compareBlocks(blockRem_, blockRemEnd_, blockAdd_, blockAddEnd_);
-	cache_.clear();
+	matches_.clear();
+	budget_.start(app->budget());
+	if(!matchLine(blockRem_, blockRemEnd_, blockAdd_, blockAddEnd_, matches_))
+		matchContext(blockRem_, blockRemEnd_, blockAdd_, blockAddEnd_, app->ignoreSpaces(), matches_);
+	arena_.reset();
+	if(budget_.wasExceeded())
+		overBudgetBlocks_++;
 
 	app->setColor(colorLineDel);
 	const char *start = blockRem_;
-	for(MatchList::iterator i = blocks.begin(); i != blocks.end(); ++i) {
+	bool newLine = true;
+	for(const Match &match : matches_) {
 		app->setHighlight(highlightOn);
-		printBlock('-', start, i->rem_);
+		newLine = printBlock('-', start, match.rem_, newLine);
 		app->setHighlight(highlightOff);
-		printBlock('-', i->rem_, i->remEnd_);
-		start = i->remEnd_;
+		newLine = printBlock('-', match.rem_, match.remEnd_, newLine);
+		start = match.remEnd_;
 	}
 	app->setHighlight(highlightOn);
-	printBlock('-', start, blockRemEnd_);
+	printBlock('-', start, blockRemEnd_, newLine);
 
 	app->setColor(colorLineAdd);
 	start = blockAdd_;
-	for(MatchList::iterator i = blocks.begin(); i != blocks.end(); ++i) {
+	newLine = true;
+	std::vector<ContextLines>::const_iterator context = contextLines_.cbegin();
+	for(const Match &match : matches_) {
 		app->setHighlight(highlightOn);
-		printBlock('+', start, i->add_);
+		newLine = printBlock('+', start, match.add_, newLine);
 		app->setHighlight(highlightOff);
-		printBlock('+', i->add_, i->addEnd_);
-		start = i->addEnd_;
+		// long runs of --reparse-range context lines are stored only in '-' block
+		while(context != contextLines_.cend() && context->addEnd > context->add)
+			++context;
+		if(context != contextLines_.cend() && match.rem_ == blockRem_ + context->rem && match.add_ == match.addEnd_) {
+			newLine = printBlock('+', match.rem_, match.remEnd_, newLine);
+			++context;
+		} else {
+			newLine = printBlock('+', match.add_, match.addEnd_, newLine);
+		}
+		start = match.addEnd_;
 	}
 	app->setHighlight(highlightOn);
-	printBlock('+', start, blockAddEnd_);
+	printBlock('+', start, blockAddEnd_, newLine);
 }
 
 /*!
@@ -597,19 +1102,24 @@ DiffParser::handleContextLine()
 	// print ' ' lines inside diff block
 
 	if(app->reparseRange()) {
-		// process '-' block
+		// line is stored once in '-' block, '+' block gets a copy only when its run is short
 		stripLineAnsi(1);
 
 		if(!blockRem_)
 			blockRem_ = line_;
 		blockRemEnd_ = line_ + lineLen_;
-
-		// process '+' block
-		stripLineAnsi(0, true, false);
-
 		if(!blockAdd_)
-			blockAdd_ = alt_;
-		blockAddEnd_ = alt_ + altLen_;
+			blockAdd_ = blockAddEnd_ = alt_ + altLen_;
+
+		// buffers can move so offsets are kept
+		const int remOffset = blockRemEnd_ - blockRem_ - lineLen_;
+		const int addOffset = blockAddEnd_ - blockAdd_;
+		if(!contextLines_.empty() && contextLines_.back().remEnd == remOffset && contextLines_.back().addEnd == addOffset) {
+			contextLines_.back().remEnd += lineLen_;
+			contextLines_.back().lines++;
+		} else {
+			contextLines_.push_back({remOffset, remOffset + lineLen_, addOffset, addOffset, 1});
+		}
 
 	} else {
 		app->setHighlight(highlightOff);
@@ -622,19 +1132,45 @@ DiffParser::handleContextLine()
 	}
 }
 
+/*!
+ * \brief Finish last run of context lines when other line or end of --reparse-range block follows it.
+ * Long runs are taken as matches and stay only in '-' block, short ones are copied to '+' block to be matched.
+ */
+void
+DiffParser::closeContextLines()
+{
+	if(contextLines_.empty())
+		return;
+
+	ContextLines &context = contextLines_.back();
+	if(context.lines >= CONTEXT_ANCHOR_MIN_LINES || context.addEnd > context.add)
+		return;
+
+	const int len = context.remEnd - context.rem;
+	resizeBuffers(0, len);
+	memcpy(alt_ + altLen_, blockRem_ + context.rem, len);
+	altLen_ += len;
+	blockAddEnd_ = alt_ + altLen_;
+	context.addEnd = context.add + len;
+}
+
 void
 DiffParser::handleRemLine()
 {
 	// handle '-' lines inside diff block
 
-	if(!app->reparseRange() && blockAdd_) // when '-' block comes after '+' block, we have to process
+	if(app->reparseRange()) {
+		closeContextLines();
+	} else if(blockAdd_) { // when '-' block comes after '+' block, we have to process
 		processBlock();
-
-	if(!blockRem_)
-		blockRem_ = line_;
+		resetBuffers();
+		inBlock_ = true;
+	}
 
 	stripLineAnsi(1);
 
+	if(!blockRem_)
+		blockRem_ = line_;
 	blockRemEnd_ = line_ + lineLen_;
 
 	// we are just preparing block buffers, they will be printed in processBlock()
@@ -645,6 +1181,7 @@ DiffParser::handleAddLine()
 {
 	// handle '+' lines inside diff block
 	if(app->reparseRange()) {
+		closeContextLines();
 		stripLineAnsi(1, true, true);
 
 		if(!blockAdd_)
@@ -652,12 +1189,11 @@ DiffParser::handleAddLine()
 
 		blockAddEnd_ = alt_ + altLen_;
 	} else {
-		if(!blockAdd_)
-			blockAdd_ = line_;
-
 		stripLineAnsi(1);
 
-		blockAddEnd_ = buf_ + bufLen_;
+		if(!blockAdd_)
+			blockAdd_ = line_;
+		blockAddEnd_ = line_ + lineLen_;
 	}
 
 	// we are just preparing block buffers, they will be printed in processBlock()
@@ -1,38 +1,38 @@
 #ifndef DIFFPARSE_H
 #define DIFFPARSE_H
 
+#include "arena.h"
+#include "bitlcs.h"
+#include "blocksketch.h"
+#include "budget.h"
+#include "linealignment.h"
+#include "linematcher.h"
+#include "lineanchors.h"
+#include "match.h"
+#include "matchcache.h"
+#include "myersdiff.h"
+#include "neonapp.h"
+#include "qgramindex.h"
+#include "suffixarray.h"
+#include "suffixautomaton.h"
+#include "tokenmatcher.h"
+
 #include <stdio.h>
-#include <list>
+#include <map>
 #include <vector>
 
 #define LINE_HANDLER_SIZE 6
 
-class Match {
-public:
-	Match(const char *rem, const char *remEnd, const char *add, const char *addEnd, int len);
-	Match();
-	const char *rem_;
-	const char *remEnd_;
-	const char *add_;
-	const char *addEnd_;
-	int len_;
-};
-
-typedef std::list<Match> MatchList;
-
-class HalfMatch {
-public:
-	HalfMatch(const char *rem, const char *remEnd, int len);
-	HalfMatch(const Match &match);
-	HalfMatch();
-	inline bool operator<(const HalfMatch &other) const { return len_ < other.len_; }
-	const char *rem_;
-	const char *remEnd_;
-	int len_;
+/*!
+ * \brief Options of the matcher, known at compile time.
+ * Per-byte loops (commonPrefix(), commonSuffix()) are instantiated for each combination, so they don't check
+ * options. Engines always match exact bytes, white-space is removed before them by matchCompacted().
+ */
+template<bool IgnoreSpaces>
+struct MatchPolicy {
+	static const bool ignoreSpaces = IgnoreSpaces;
 };
 
-typedef std::list<HalfMatch> HalfMatchList;
-
 class DiffParser
 {
 public:
@@ -44,7 +44,8 @@ public:
 	bool readLine();
 
 protected:
-	void resizeBuffers();
+	bool fillInput();
+	void resizeBuffers(int bufNeeded, int altNeeded);
 	void resetBuffers();
 
 	bool handlerForLine(const char *line, const char *id, int n);
@@ -53,26 +54,64 @@ protected:
 	void handleRangeInfoLine();
 
 	void handleContextLine();
+	void closeContextLines();
 	void handleRemLine();
 	void handleAddLine();
 
 	void handleGenericLine();
 
-	void printBlock(const char id, const char *block, const char *blockEnd);
+	bool printBlock(const char id, const char *block, const char *blockEnd, bool newLine);
 	void processBlock();
 
 	void stripLineAnsi(int stripIndent = 0, bool writeToAlt = false, bool moveToAlt = false);
 
+	int runMatchLength(const char *rem, const char *remEnd, int remRun, const char *pos, const char *addEnd,
+			const char *add) const;
 	void buildMatchCache(const char *rem, const char *remEnd, const char *add, const char *addEnd);
-	Match longestMake(const char *rem, const char *remEnd, const char *add, const char *addEnd, const int len);
-	void cacheClip(const char *rem, const char *remEnd);
-	Match longestMatch(const char *rem, const char *remEnd, const char *add, const char *addEnd);
-	MatchList compareBlocks(const char *a, const char *aEnd, const char *b, const char *bEnd);
+	void buildIndexedMatchCache(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	Match longestMatch(const HalfMatch &entry, const char *add, const char *addEnd);
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+	int compactSpaces(const char *block, const char *blockEnd, char *&compact, const char **&map);
+	void matchCompacted(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+	template<typename Policy>
+	Match commonPrefix(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	template<typename Policy>
+	Match commonSuffix(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	bool unrelatedBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	MatchEngine selectEngine(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	void matchEngine(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+	void matchTrimmed(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+	bool matchLine(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+	void matchAligned(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+	void matchAnchored(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+	void matchBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+	void matchContext(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+
+	void addStats(int matcher, const char *rem, const char *remEnd, const char *add, const char *addEnd, long start);
+	void printStats();
 
 	void printLineNoAnsi(int length = -1);
 
 private:
+	typedef std::map<const char *, Match, std::less<const char *>,
+			ArenaAllocator<std::pair<const char *const, Match>>> RangeMap;
+
 	FILE *input_;
+	int inputFd_;
+
+	char *in_;
+	int inPos_;
+	int inLen_;
+	int inSize_;
+	bool inEof_;
+	bool inMapped_;
 
 	char *buf_;
 	int bufLen_;
@@ -89,8 +128,48 @@ private:
 	const char *blockRemEnd_;
 	const char *blockAdd_;
 	const char *blockAddEnd_;
-
-	HalfMatchList cache_;
+	MatchList matches_;
+
+	// consecutive context lines of --reparse-range block, offsets from start of '-' and '+' blocks,
+	// lines are stored in '-' block and copied to '+' block only for short runs (add == addEnd otherwise)
+	struct ContextLines {
+		int rem;
+		int remEnd;
+		int add;
+		int addEnd;
+		int lines;
+	};
+	std::vector<ContextLines> contextLines_;
+	Budget budget_;
+
+	// statistics (--stats), engines are indexed by engine, followed by matchers that are not selected by it
+	enum { statsBitLcs = engineAuto, statsToken, statsSize };
+	struct EngineStats {
+		int blocks;
+		long bytes;
+		long time;
+	};
+	EngineStats engineStats_[statsSize];
+	long selectTime_;
+	int overBudgetBlocks_;
+	int unrelatedBlocks_;
+	int lineBlocks_;
+
+	// memory of matchers, released after each hunk
+	Arena arena_;
+	MatchCache cache_;
+	QGramIndex qgrams_;
+	std::vector<int> addRuns_;
+	SuffixAutomaton automaton_;
+	SuffixArray suffixArray_;
+	MyersDiff myers_;
+	BitLcs bitLcs_;
+	LineAnchors lineAnchors_;
+	std::vector<Match> anchors_;
+	LineAlignment lineAlignment_;
+	std::vector<Match> linePairs_;
+	TokenMatcher tokenMatcher_;
+	BlockSketch sketch_;
 
 	typedef void (DiffParser::* LineHandlerCallback)();
 
@@ -0,0 +1,150 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "linealignment.h"
+
+#include "characters.h"
+
+#include <algorithm>
+
+// lines less similar than this are never paired
+#define MIN_SIMILARITY 0.4f
+// bigger blocks are not aligned, dynamic programming table would be too big
+#define MAX_LINE_PAIRS (1 << 20)
+
+enum AlignStep {
+	stepPair,
+	stepSkipRem,
+	stepSkipAdd
+};
+
+static inline int
+popCount(uint64_t value)
+{
+	return __builtin_popcountll(value);
+}
+
+void
+LineAlignment::splitLines(const char *block, const char *blockEnd, bool ignoreSpaces, std::vector<Line> &lines)
+{
+	lines.clear();
+	while(block < blockEnd) {
+		Line line;
+		line.start = block;
+		std::fill(line.signature, line.signature + LINE_SIGNATURE_WORDS, 0);
+
+		// set one bit for each pair of neighbouring characters
+		unsigned char prev = '\n';
+		while(block < blockEnd) {
+			const char ch = *block++;
+			if(ch == '\n')
+				break;
+			if(ignoreSpaces && isSpace(ch))
+				continue;
+			const unsigned bit = (prev * 31u + static_cast<unsigned char>(ch)) * 2654435761u >> 24;
+			line.signature[bit / 64 % LINE_SIGNATURE_WORDS] |= uint64_t(1) << (bit % 64);
+			prev = ch;
+		}
+		line.end = block;
+
+		line.bits = 0;
+		for(int w = 0; w < LINE_SIGNATURE_WORDS; w++)
+			line.bits += popCount(line.signature[w]);
+		lines.push_back(line);
+	}
+}
+
+float
+LineAlignment::similarity(const Line &a, const Line &b)
+{
+	if(!a.bits || !b.bits)
+		return 0.0f;
+
+	int common = 0;
+	for(int w = 0; w < LINE_SIGNATURE_WORDS; w++)
+		common += popCount(a.signature[w] & b.signature[w]);
+	return 2.0f * common / (a.bits + b.bits);
+}
+
+/*!
+ * \brief Fill \p pairs with similar lines of \p rem and \p add blocks, in order.
+ * \return false when blocks are too big to be aligned
+ */
+bool
+LineAlignment::align(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		std::vector<Match> &pairs)
+{
+	pairs.clear();
+
+	splitLines(rem, remEnd, ignoreSpaces, remLines_);
+	splitLines(add, addEnd, ignoreSpaces, addLines_);
+
+	const int remCount = remLines_.size();
+	const int addCount = addLines_.size();
+	if(static_cast<long>(remCount) * addCount > MAX_LINE_PAIRS)
+		return false;
+
+	// score_ of [i, j] is best total similarity of first i '-' and first j '+' lines
+	const int width = addCount + 1;
+	score_.assign((remCount + 1) * width, 0.0f);
+	step_.assign((remCount + 1) * width, stepSkipRem);
+	for(int j = 1; j <= addCount; j++)
+		step_[j] = stepSkipAdd;
+
+	for(int i = 1; i <= remCount; i++) {
+		for(int j = 1; j <= addCount; j++) {
+			float best = score_[(i - 1) * width + j];
+			char step = stepSkipRem;
+			if(score_[i * width + j - 1] > best) {
+				best = score_[i * width + j - 1];
+				step = stepSkipAdd;
+			}
+			const float sim = similarity(remLines_[i - 1], addLines_[j - 1]);
+			if(sim >= MIN_SIMILARITY && score_[(i - 1) * width + j - 1] + sim >= best) {
+				best = score_[(i - 1) * width + j - 1] + sim;
+				step = stepPair;
+			}
+			score_[i * width + j] = best;
+			step_[i * width + j] = step;
+		}
+	}
+
+	for(int i = remCount, j = addCount; i > 0 && j > 0;) {
+		switch(step_[i * width + j]) {
+		case stepPair: {
+			const Line &r = remLines_[i - 1];
+			const Line &a = addLines_[j - 1];
+			pairs.push_back(Match(r.start, r.end, a.start, a.end, r.end - r.start));
+			i--;
+			j--;
+			break;
+		}
+		case stepSkipRem:
+			i--;
+			break;
+		default:
+			j--;
+			break;
+		}
+	}
+	std::reverse(pairs.begin(), pairs.end());
+
+	return true;
+}
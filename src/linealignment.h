@@ -0,0 +1,38 @@
+#ifndef LINEALIGNMENT_H
+#define LINEALIGNMENT_H
+
+#include "match.h"
+
+#include <stdint.h>
+#include <vector>
+
+#define LINE_SIGNATURE_WORDS 4
+
+/*!
+ * \brief Pairs '-' lines with most similar '+' lines, keeping their order.
+ * Similarity of lines is estimated from hashed character pairs, best pairing is found with dynamic programming.
+ */
+class LineAlignment
+{
+public:
+	bool align(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			std::vector<Match> &pairs);
+
+private:
+	struct Line {
+		const char *start;
+		const char *end;
+		uint64_t signature[LINE_SIGNATURE_WORDS];
+		int bits;
+	};
+
+	void splitLines(const char *block, const char *blockEnd, bool ignoreSpaces, std::vector<Line> &lines);
+	static float similarity(const Line &a, const Line &b);
+
+	std::vector<Line> remLines_;
+	std::vector<Line> addLines_;
+	std::vector<float> score_;
+	std::vector<char> step_;
+};
+
+#endif // LINEALIGNMENT_H
@@ -0,0 +1,132 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "lineanchors.h"
+
+#include "characters.h"
+
+#include <algorithm>
+
+LineAnchors::LineAnchors(Arena *arena)
+	: arena_(arena)
+{
+}
+
+void
+LineAnchors::splitLines(const char *block, const char *blockEnd, bool ignoreSpaces, std::vector<Line> &lines)
+{
+	lines.clear();
+	while(block < blockEnd) {
+		// FNV-1a hash of line, white-space is skipped when ignoring it
+		uint64_t hash = 14695981039346656037ULL;
+		const char *lineEnd = block;
+		while(lineEnd < blockEnd) {
+			const char ch = *lineEnd++;
+			if(!ignoreSpaces || !isSpace(ch))
+				hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ULL;
+			if(ch == '\n')
+				break;
+		}
+		lines.push_back({block, lineEnd, hash});
+		block = lineEnd;
+	}
+}
+
+bool
+LineAnchors::sameLine(const Line &a, const Line &b, bool ignoreSpaces)
+{
+	if(a.hash != b.hash)
+		return false;
+
+	const char *i = a.start;
+	const char *j = b.start;
+	for(;;) {
+		if(ignoreSpaces) {
+			while(i < a.end && isSpace(*i))
+				i++;
+			while(j < b.end && isSpace(*j))
+				j++;
+		}
+		if(i == a.end || j == b.end)
+			return i == a.end && j == b.end;
+		if(*i++ != *j++)
+			return false;
+	}
+}
+
+/*!
+ * \brief Fill \p anchors with longest increasing sequence of lines that are unique and equal in both blocks.
+ */
+void
+LineAnchors::find(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+		std::vector<Match> &anchors)
+{
+	anchors.clear();
+
+	splitLines(rem, remEnd, ignoreSpaces, remLines_);
+	splitLines(add, addEnd, ignoreSpaces, addLines_);
+
+	typedef std::pair<const uint64_t, Occurrence> OccurrenceItem;
+	std::unordered_map<uint64_t, Occurrence, std::hash<uint64_t>, std::equal_to<uint64_t>, ArenaAllocator<OccurrenceItem>>
+		occurrences(remLines_.size(), std::hash<uint64_t>(), std::equal_to<uint64_t>(), ArenaAllocator<OccurrenceItem>(arena_));
+	for(int i = 0, n = remLines_.size(); i < n; i++) {
+		Occurrence &o = occurrences[remLines_[i].hash];
+		o.remCount++;
+		o.remLine = i;
+	}
+	for(int i = 0, n = addLines_.size(); i < n; i++) {
+		auto it = occurrences.find(addLines_[i].hash);
+		if(it != occurrences.end()) {
+			it->second.addCount++;
+			it->second.addLine = i;
+		}
+	}
+
+	// unique lines in '-' order
+	candidates_.clear();
+	for(int i = 0, n = remLines_.size(); i < n; i++) {
+		const Occurrence &o = occurrences[remLines_[i].hash];
+		if(o.remCount == 1 && o.addCount == 1 && sameLine(remLines_[i], addLines_[o.addLine], ignoreSpaces))
+			candidates_.push_back({i, o.addLine});
+	}
+	if(candidates_.empty())
+		return;
+
+	// patience sorting, tails_[k] is candidate ending increasing sequence of length k + 1
+	tails_.clear();
+	previous_.assign(candidates_.size(), -1);
+	for(int c = 0, n = candidates_.size(); c < n; c++) {
+		auto it = std::lower_bound(tails_.begin(), tails_.end(), candidates_[c].addLine,
+			[this](int candidate, int addLine) { return candidates_[candidate].addLine < addLine; });
+		if(it != tails_.begin())
+			previous_[c] = *(it - 1);
+		if(it == tails_.end())
+			tails_.push_back(c);
+		else
+			*it = c;
+	}
+
+	for(int c = tails_.back(); c != -1; c = previous_[c]) {
+		const Line &r = remLines_[candidates_[c].remLine];
+		const Line &a = addLines_[candidates_[c].addLine];
+		anchors.push_back(Match(r.start, r.end, a.start, a.end, r.end - r.start));
+	}
+	std::reverse(anchors.begin(), anchors.end());
+}
@@ -0,0 +1,53 @@
+#ifndef LINEANCHORS_H
+#define LINEANCHORS_H
+
+#include "arena.h"
+#include "match.h"
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * \brief Finds lines that occur exactly once in both '-' and '+' blocks (patience diff).
+ * Such lines are used as fixed matches that split big blocks into independent smaller ones.
+ */
+class LineAnchors
+{
+public:
+	LineAnchors(Arena *arena = nullptr);
+
+	void find(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			std::vector<Match> &anchors);
+
+private:
+	struct Line {
+		const char *start;
+		const char *end;
+		uint64_t hash;
+	};
+
+	struct Candidate {
+		int remLine;
+		int addLine;
+	};
+
+	struct Occurrence {
+		int remCount;
+		int remLine;
+		int addCount;
+		int addLine;
+	};
+
+	void splitLines(const char *block, const char *blockEnd, bool ignoreSpaces, std::vector<Line> &lines);
+	static bool sameLine(const Line &a, const Line &b, bool ignoreSpaces);
+
+	Arena *arena_;
+	std::vector<Line> remLines_;
+	std::vector<Line> addLines_;
+	std::vector<Candidate> candidates_;
+	std::vector<int> tails_;
+	std::vector<int> previous_;
+};
+
+#endif // LINEANCHORS_H
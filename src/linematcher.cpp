@@ -0,0 +1,174 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "linematcher.h"
+#include "commonlength.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// positions are offsets into blocks
+struct LineEntry {
+	int rem;
+	int remEnd;
+	int len;
+	unsigned stamp;
+};
+
+struct LineRange {
+	int rem;
+	int remEnd;
+	int add;
+	int addEnd;
+	int len;
+};
+
+inline bool
+less(const LineEntry &x, const LineEntry &y)
+{
+	return x.len < y.len || (x.len == y.len && x.stamp < y.stamp);
+}
+
+}
+
+/*!
+ * \brief Append matches of \p rem and \p add blocks to \p list, longest first like DiffParser::compareBlocks().
+ * \return false when blocks are longer than LINE_MATCHER_MAX_SIZE or entries don't fit, nothing is appended then
+ */
+bool
+LineMatcher::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	assert(rem <= remEnd);
+	assert(add <= addEnd);
+
+	const int remLen = remEnd - rem;
+	const int addLen = addEnd - add;
+	if(remLen > LINE_MATCHER_MAX_SIZE || addLen > LINE_MATCHER_MAX_SIZE)
+		return false;
+
+	LineEntry entries[LINE_MATCHER_MAX_ENTRIES];
+	int entryCount = 0;
+	unsigned stamp = 0;
+
+	// longest matches of each '-' position, moving past found matches
+	for(int r = 0; r < remLen;) {
+		int iMax = 0;
+		for(int p = 0; p < addLen; p++) {
+			if(add[p] != rem[r])
+				continue;
+			const int len = commonLength(rem + r, add + p, std::min(remLen - r, addLen - p));
+			if(len > iMax) {
+				entries[entryCount++] = {r, r + len, len, stamp++};
+				iMax = len;
+			}
+		}
+		r += iMax > 0 ? iMax : 1;
+	}
+
+	const size_t listSize = list.size();
+	LineRange pending[2 * LINE_MATCHER_MAX_SIZE + 1];
+	int pendingCount = 0;
+	int clipped[LINE_MATCHER_MAX_ENTRIES];
+
+	pending[pendingCount++] = {0, remLen, 0, addLen, 0};
+	while(pendingCount) {
+		const LineRange top = pending[--pendingCount];
+		if(top.len) {
+			list.push_back(Match(rem + top.rem, rem + top.remEnd, add + top.add, add + top.addEnd, top.len));
+			continue;
+		}
+
+		// longest entry of range, first full or longest partial match of it in '+' range
+		LineRange match = {0, 0, 0, 0, 0};
+		for(;;) {
+			int best = -1;
+			for(int id = 0; id < entryCount; id++) {
+				const LineEntry &entry = entries[id];
+				if(entry.len && entry.rem >= top.rem && entry.remEnd <= top.remEnd
+						&& (best == -1 || less(entries[best], entry)))
+					best = id;
+			}
+			if(best == -1)
+				break;
+
+			const LineEntry &entry = entries[best];
+			const int len = entry.remEnd - entry.rem;
+			for(int p = top.add; p < top.addEnd; p++) {
+				if(add[p] != rem[entry.rem])
+					continue;
+				const int common = commonLength(rem + entry.rem, add + p, std::min(len, top.addEnd - p));
+				if(common > match.len)
+					match = {entry.rem, entry.rem + common, p, p + common, common};
+				if(common == len)
+					break;
+			}
+			entries[best].len = 0;
+			if(match.len)
+				break;
+		}
+		if(!match.len)
+			continue;
+
+		// clip matched part out of entries, shortened ones get new stamps in their order
+		int clippedCount = 0;
+		for(int id = 0; id < entryCount; id++) {
+			LineEntry &entry = entries[id];
+			if(!entry.len || entry.rem >= match.remEnd || match.rem >= entry.remEnd)
+				continue;
+			if(entry.rem >= match.rem && entry.remEnd <= match.remEnd)
+				entry.len = 0;
+			else
+				clipped[clippedCount++] = id;
+		}
+		std::sort(clipped, clipped + clippedCount, [&entries](int a, int b) { return less(entries[a], entries[b]); });
+
+		for(int i = 0; i < clippedCount; i++) {
+			LineEntry &entry = entries[clipped[i]];
+			const int entryEnd = entry.remEnd;
+			const bool pieceBefore = entry.rem < match.rem;
+			if(pieceBefore) {
+				entry.remEnd = match.rem;
+				entry.len = match.rem - entry.rem;
+				entry.stamp = stamp++;
+			}
+			if(entryEnd > match.remEnd) {
+				const LineEntry piece = {match.remEnd, entryEnd, entryEnd - match.remEnd, stamp++};
+				if(!pieceBefore)
+					entry = piece;
+				else if(entryCount < LINE_MATCHER_MAX_ENTRIES)
+					entries[entryCount++] = piece;
+				else {
+					list.resize(listSize);
+					return false;
+				}
+			}
+		}
+
+		if(match.remEnd < top.remEnd && match.addEnd < top.addEnd)
+			pending[pendingCount++] = {match.remEnd, top.remEnd, match.addEnd, top.addEnd, 0};
+		pending[pendingCount++] = match;
+		if(top.rem < match.rem && top.add < match.add)
+			pending[pendingCount++] = {top.rem, match.rem, top.add, match.add, 0};
+	}
+
+	return true;
+}
@@ -0,0 +1,21 @@
+#ifndef LINEMATCHER_H
+#define LINEMATCHER_H
+
+#include "match.h"
+
+#define LINE_MATCHER_MAX_SIZE 256
+#define LINE_MATCHER_MAX_ENTRIES (4 * LINE_MATCHER_MAX_SIZE)
+
+/*!
+ * \brief Match cache of DiffParser for single short lines, kept in fixed arrays on the stack.
+ * Entries are built, picked and clipped in same order as by DiffParser::buildMatchCache(), MatchCache and
+ * DiffParser::compareBlocks(), so matches are identical. There are few entries, so they are scanned
+ * instead of being kept in sorted segments.
+ */
+class LineMatcher
+{
+public:
+	static bool compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+};
+
+#endif // LINEMATCHER_H
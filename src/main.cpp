@@ -62,11 +62,16 @@ main(int argc, char *argv[])
 			{"tab-width", required_argument, nullptr, 't'},
 			{"show-tabs", optional_argument, nullptr, 'T'},
 			{"reparse-range", no_argument, nullptr, 'r'},
+			{"engine", required_argument, nullptr, 'e'},
+			{"align-lines", no_argument, nullptr, 'l'},
+			{"word-diff", no_argument, nullptr, 'w'},
+			{"budget", required_argument, nullptr, 'b'},
+			{"stats", no_argument, nullptr, 'S'},
 			{"help", no_argument, 0, 'h'},
 			{0, 0, 0, 0}
 		};
 
-		const int ch = getopt_long(argc, argv, "i:o:sI:t:T::rh", longOpts, nullptr);
+		const int ch = getopt_long(argc, argv, "i:o:sI:t:T::re:lwb:Sh", longOpts, nullptr);
 
 		if(ch == -1)
 			break;
@@ -105,6 +110,41 @@ main(int argc, char *argv[])
 			NeonApp::reparseRange_ = true;
 			break;
 
+		case 'e': // engine
+			if(strcmp(optarg, "cache") == 0) {
+				NeonApp::matchEngine_ = engineCache;
+			} else if(strcmp(optarg, "automaton") == 0) {
+				NeonApp::matchEngine_ = engineAutomaton;
+			} else if(strcmp(optarg, "suffix-array") == 0) {
+				NeonApp::matchEngine_ = engineSuffixArray;
+			} else if(strcmp(optarg, "myers") == 0) {
+				NeonApp::matchEngine_ = engineMyers;
+			} else if(strcmp(optarg, "auto") == 0) {
+				NeonApp::matchEngine_ = engineAuto;
+			} else {
+				fprintf(stderr, "ERROR: Unknown matching engine \"%s\".\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'l': // align-lines
+			NeonApp::alignLines_ = true;
+			break;
+
+		case 'w': // word-diff
+			NeonApp::wordDiff_ = true;
+			break;
+
+		case 'b': // budget
+			NeonApp::budget_ = atoi(optarg);
+			if(NeonApp::budget_ < 0)
+				NeonApp::budget_ = 0;
+			break;
+
+		case 'S': // stats
+			NeonApp::stats_ = true;
+			break;
+
 		case 'h': // help
 			fprintf(stderr,
 					"Usage: neon-diff [-h] [-i <input file>] [-o <output file>] [input file]...\n"
@@ -122,6 +162,20 @@ main(int argc, char *argv[])
 					"  -r, --reparse-range        reparse whole block between '@@' lines. This will better detect\n"
 					"                             changes between separated '+/-' lines, but will change the diff\n"
 					"                             (might break git's interactive.diffFilter)\n"
+					"  -e, --engine=<name>        engine used to find matching parts of changed lines:\n"
+					"                               cache      compare all positions, cache longest matches (default)\n"
+					"                               automaton  find longest common substrings with suffix automaton\n"
+					"                               suffix-array  same matches as automaton, using suffix array\n"
+					"                               myers      shortest edit script, fast on big similar blocks\n"
+					"                                          (small blocks use bit-parallel LCS)\n"
+					"                               auto       pick engine for each block by its size and similarity\n"
+					"  -l, --align-lines          pair each changed line with most similar line and highlight\n"
+					"                             changes only between paired lines\n"
+					"  -w, --word-diff            match whole words, numbers and punctuation instead of single\n"
+					"                             characters (--engine is not used)\n"
+					"  -b, --budget=<ms>          stop matching a block after <ms> milliseconds, rest of it is\n"
+					"                             only matched by common start and end (default: 0, unlimited)\n"
+					"  -S, --stats                print blocks, bytes and time of each engine to stderr\n"
 					"\n"
 					"  -h, --help                 show this help message\n"
 					"\n"
@@ -0,0 +1,39 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "match.h"
+
+Match::Match()
+	: rem_(nullptr),
+	  remEnd_(nullptr),
+	  add_(nullptr),
+	  addEnd_(nullptr),
+	  len_(0)
+{
+}
+
+Match::Match(const char *rem, const char *remEnd, const char *add, const char *addEnd, int len)
+	: rem_(rem),
+	  remEnd_(remEnd),
+	  add_(add),
+	  addEnd_(addEnd),
+	  len_(len)
+{
+}
@@ -0,0 +1,19 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <vector>
+
+class Match {
+public:
+	Match(const char *rem, const char *remEnd, const char *add, const char *addEnd, int len);
+	Match();
+	const char *rem_;
+	const char *remEnd_;
+	const char *add_;
+	const char *addEnd_;
+	int len_;
+};
+
+typedef std::vector<Match> MatchList;
+
+#endif // MATCH_H
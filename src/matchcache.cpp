@@ -0,0 +1,178 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "matchcache.h"
+
+#include <algorithm>
+
+HalfMatch::HalfMatch()
+	: rem_(nullptr),
+	  remEnd_(nullptr),
+	  add_(nullptr),
+	  len_(0),
+	  stamp_(0),
+	  next_(-1)
+{
+}
+
+HalfMatch::HalfMatch(const char *rem, const char *remEnd, const char *add, int len, unsigned stamp)
+	: rem_(rem),
+	  remEnd_(remEnd),
+	  add_(add),
+	  len_(len),
+	  stamp_(stamp),
+	  next_(-1)
+{
+}
+
+MatchCache::MatchCache()
+	: stamp_(0)
+{
+}
+
+void
+MatchCache::clear()
+{
+	entries_.clear();
+	segments_.clear();
+	heap_.clear();
+	stamp_ = 0;
+}
+
+bool
+MatchCache::less(int a, int b) const
+{
+	const HalfMatch &x = entries_[a];
+	const HalfMatch &y = entries_[b];
+	return x.len_ < y.len_ || (x.len_ == y.len_ && x.stamp_ < y.stamp_);
+}
+
+void
+MatchCache::push(int id)
+{
+	heap_.push_back({entries_[id].len_, entries_[id].stamp_, id});
+	std::push_heap(heap_.begin(), heap_.end());
+}
+
+/*!
+ * \brief Add match starting at \p rem. Matches must be added in order of their start.
+ * \param add first position in '+' block where whole match is found
+ */
+void
+MatchCache::add(const char *rem, const char *remEnd, const char *add, int len)
+{
+	const int id = entries_.size();
+	entries_.push_back(HalfMatch(rem, remEnd, add, len, stamp_++));
+	push(id);
+
+	if(segments_.empty() || segments_.back().rem_ != rem) {
+		segments_.push_back({rem, remEnd, id});
+		return;
+	}
+	Segment &segment = segments_.back();
+	entries_[id].next_ = segment.first_;
+	segment.first_ = id;
+	if(segment.remEnd_ < remEnd)
+		segment.remEnd_ = remEnd;
+}
+
+std::vector<MatchCache::Segment>::iterator
+MatchCache::firstSegment(const char *rem)
+{
+	return std::upper_bound(segments_.begin(), segments_.end(), rem,
+			[](const char *pos, const Segment &segment) { return pos < segment.remEnd_; });
+}
+
+/*!
+ * \brief Remove \p rem - \p remEnd range from all entries.
+ * Entries that get shorter are ordered after untouched entries of their new length, in their previous order.
+ * Their '+' position is dropped, pieces can be found earlier in '+' block than whole entry was.
+ */
+void
+MatchCache::clip(const char *rem, const char *remEnd)
+{
+	clipped_.clear();
+	for(std::vector<Segment>::iterator s = firstSegment(rem); s != segments_.end() && s->rem_ < remEnd; ++s) {
+		for(int id = s->first_; id != -1; id = entries_[id].next_) {
+			HalfMatch &entry = entries_[id];
+			if(!entry.rem_ || entry.rem_ >= remEnd || rem >= entry.remEnd_)
+				continue;
+			if(entry.rem_ >= rem && entry.remEnd_ <= remEnd)
+				entry.rem_ = nullptr; // clip includes it
+			else
+				clipped_.push_back(id);
+		}
+	}
+
+	std::sort(clipped_.begin(), clipped_.end(), [this](int a, int b) { return less(a, b); });
+
+	for(const int id : clipped_) {
+		const char *entryEnd = entries_[id].remEnd_;
+		const bool pieceBefore = entries_[id].rem_ < rem;
+		const bool pieceAfter = entryEnd > remEnd;
+		if(pieceBefore) {
+			HalfMatch &entry = entries_[id];
+			entry.remEnd_ = rem;
+			entry.add_ = nullptr;
+			entry.len_ = rem - entry.rem_;
+			entry.stamp_ = stamp_++;
+			push(id);
+		}
+		if(pieceAfter) {
+			if(pieceBefore) {
+				const int piece = entries_.size();
+				entries_.push_back(HalfMatch(remEnd, entryEnd, nullptr, entryEnd - remEnd, stamp_++));
+				entries_[piece].next_ = entries_[id].next_;
+				entries_[id].next_ = piece;
+				push(piece);
+			} else {
+				HalfMatch &entry = entries_[id];
+				entry.rem_ = remEnd;
+				entry.add_ = nullptr;
+				entry.len_ = entryEnd - remEnd;
+				entry.stamp_ = stamp_++;
+				push(id);
+			}
+		}
+	}
+}
+
+/*!
+ * \brief Longest (and newest) entry, -1 when there are none left.
+ */
+int
+MatchCache::longest()
+{
+	while(!heap_.empty()) {
+		const HeapItem &top = heap_.front();
+		const HalfMatch &entry = entries_[top.id_];
+		if(entry.rem_ && entry.stamp_ == top.stamp_)
+			return top.id_;
+		std::pop_heap(heap_.begin(), heap_.end());
+		heap_.pop_back();
+	}
+	return -1;
+}
+
+void
+MatchCache::erase(int id)
+{
+	entries_[id].rem_ = nullptr;
+}
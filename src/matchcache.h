@@ -0,0 +1,72 @@
+#ifndef MATCHCACHE_H
+#define MATCHCACHE_H
+
+#include <vector>
+
+class HalfMatch {
+public:
+	HalfMatch(const char *rem, const char *remEnd, const char *add, int len, unsigned stamp);
+	HalfMatch();
+	const char *rem_;
+	const char *remEnd_;
+	// first position of whole entry in '+' block, nullptr once entry is clipped
+	const char *add_;
+	int len_;
+	// entries of same length are tried from highest stamp
+	unsigned stamp_;
+	// next entry of same segment, -1 at end
+	int next_;
+};
+
+/*!
+ * \brief Longest matches of '-' block positions, found by DiffParser::buildMatchCache().
+ * Entries are stored in a vector and never moved, erased ones are only marked. Matches found from one
+ * position don't overlap matches of other positions, so entries are grouped into sorted, disjoint
+ * segments, which are binary searched when clipping entries of a range.
+ * All entries are kept on a max-heap on length and stamp. Clipped entries are pushed again with their new
+ * length and stamp, heap items that don't match their entry anymore are skipped when reaching the top.
+ * Each entry also keeps its first position in '+' block. Ranges left after a match never contain the
+ * matched '+' part, so when that position lies in range of the entry it is the first one there too.
+ */
+class MatchCache
+{
+public:
+	MatchCache();
+
+	void clear();
+	void add(const char *rem, const char *remEnd, const char *add, int len);
+	void clip(const char *rem, const char *remEnd);
+
+	int longest();
+	void erase(int id);
+	inline HalfMatch &operator[](int id) { return entries_[id]; }
+
+private:
+	struct Segment {
+		const char *rem_;
+		const char *remEnd_;
+		int first_;
+	};
+
+	struct HeapItem {
+		int len_;
+		unsigned stamp_;
+		int id_;
+
+		inline bool operator<(const HeapItem &other) const {
+			return len_ < other.len_ || (len_ == other.len_ && stamp_ < other.stamp_);
+		}
+	};
+
+	std::vector<Segment>::iterator firstSegment(const char *rem);
+	bool less(int a, int b) const;
+	void push(int id);
+
+	std::vector<HalfMatch> entries_;
+	std::vector<Segment> segments_;
+	std::vector<HeapItem> heap_;
+	std::vector<int> clipped_;
+	unsigned stamp_;
+};
+
+#endif // MATCHCACHE_H
@@ -0,0 +1,219 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "myersdiff.h"
+
+#include <cassert>
+
+// edit scripts longer than this are not searched for, see MyersDiff::middleSnake()
+#define MYERS_COST_LIMIT 256
+
+MyersDiff::MyersDiff(Budget *budget)
+	: budget_(budget)
+{
+}
+
+void
+MyersDiff::pushMatch(const char *rem, const char *add, int len, MatchList &list)
+{
+	if(!len)
+		return;
+
+	// join with previous match when they touch
+	if(!list.empty() && list.back().remEnd_ == rem && list.back().addEnd_ == add) {
+		list.back().remEnd_ += len;
+		list.back().addEnd_ += len;
+		list.back().len_ += len;
+		return;
+	}
+	list.push_back(Match(rem, rem + len, add, add + len, len));
+}
+
+/*!
+ * \brief Find point where forward and backward shortest edit paths meet, using linear space.
+ * Like GNU diff, when paths get too long, search stops and the point furthest reached by either of them is used,
+ * so script is no longer shortest, but dissimilar blocks don't take quadratic time.
+ * \return false when blocks have nothing in common or time budget is used up
+ */
+bool
+MyersDiff::middleSnake(const char *rem, const char *remEnd, const char *add, const char *addEnd,
+		const char **remSplit, const char **addSplit)
+{
+	const int n = remEnd - rem;
+	const int m = addEnd - add;
+	const int maxD = (n + m + 1) / 2;
+	const int offset = maxD;
+	const int size = 2 * maxD + 2;
+
+	// furthest reaching x on each diagonal k = x - y, forward from start and backward from end
+	// diagonals are initialized as paths grow, so short scripts don't pay for size of the blocks
+	if(static_cast<int>(forward_.size()) < size) {
+		forward_.resize(size);
+		backward_.resize(size);
+	}
+	forward_[offset - 1] = forward_[offset] = backward_[offset - 1] = backward_[offset] = -1;
+	forward_[offset + 1] = backward_[offset + 1] = 0;
+	int radius = 1;
+
+	// when delta is odd forward path will detect the overlap, backward otherwise
+	const int delta = n - m;
+	const bool front = delta % 2 != 0;
+
+	// diagonals that went out of the grid are not followed anymore
+	int forwardStart = 0;
+	int forwardEnd = 0;
+	int backwardStart = 0;
+	int backwardEnd = 0;
+
+	for(int d = 0; d < maxD; d++) {
+		if(budget_ && budget_->exceeded())
+			return false;
+
+		if(d + 1 > radius) {
+			radius = d + 1;
+			forward_[offset - radius] = forward_[offset + radius] = -1;
+			backward_[offset - radius] = backward_[offset + radius] = -1;
+		}
+
+		for(int k = -d + forwardStart; k <= d - forwardEnd; k += 2) {
+			const int kOffset = offset + k;
+			int x = k == -d || (k != d && forward_[kOffset - 1] < forward_[kOffset + 1])
+				? forward_[kOffset + 1] : forward_[kOffset - 1] + 1;
+			int y = x - k;
+			while(x < n && y < m && rem[x] == add[y]) {
+				x++;
+				y++;
+			}
+			forward_[kOffset] = x;
+			if(x > n) {
+				forwardEnd += 2;
+			} else if(y > m) {
+				forwardStart += 2;
+			} else if(front) {
+				const int backwardOffset = offset + delta - k;
+				if(backwardOffset >= offset - radius && backwardOffset <= offset + radius
+					&& backward_[backwardOffset] != -1
+					&& x >= n - backward_[backwardOffset]) {
+					*remSplit = rem + x;
+					*addSplit = add + y;
+					return true;
+				}
+			}
+		}
+
+		for(int k = -d + backwardStart; k <= d - backwardEnd; k += 2) {
+			const int kOffset = offset + k;
+			int x = k == -d || (k != d && backward_[kOffset - 1] < backward_[kOffset + 1])
+				? backward_[kOffset + 1] : backward_[kOffset - 1] + 1;
+			int y = x - k;
+			while(x < n && y < m && rem[n - x - 1] == add[m - y - 1]) {
+				x++;
+				y++;
+			}
+			backward_[kOffset] = x;
+			if(x > n) {
+				backwardEnd += 2;
+			} else if(y > m) {
+				backwardStart += 2;
+			} else if(!front) {
+				const int forwardOffset = offset + delta - k;
+				if(forwardOffset >= offset - radius && forwardOffset <= offset + radius
+					&& forward_[forwardOffset] != -1) {
+					const int forwardX = forward_[forwardOffset];
+					if(forwardX >= n - x) {
+						*remSplit = rem + forwardX;
+						*addSplit = add + forwardX - (forwardOffset - offset);
+						return true;
+					}
+				}
+			}
+		}
+
+		if(d + 1 >= MYERS_COST_LIMIT) {
+			// progress of a path is x + y, backward paths count from the end
+			int forwardBest = 0;
+			int forwardX = 0;
+			int forwardY = 0;
+			for(int k = -d + forwardStart; k <= d - forwardEnd; k += 2) {
+				const int x = forward_[offset + k];
+				if(x <= n && x - k <= m && 2 * x - k > forwardBest) {
+					forwardBest = 2 * x - k;
+					forwardX = x;
+					forwardY = x - k;
+				}
+			}
+			int backwardBest = 0;
+			int backwardX = 0;
+			int backwardY = 0;
+			for(int k = -d + backwardStart; k <= d - backwardEnd; k += 2) {
+				const int x = backward_[offset + k];
+				if(x <= n && x - k <= m && 2 * x - k > backwardBest) {
+					backwardBest = 2 * x - k;
+					backwardX = n - x;
+					backwardY = m - x + k;
+				}
+			}
+			if(forwardBest >= backwardBest && forwardBest > 0 && forwardBest < n + m) {
+				*remSplit = rem + forwardX;
+				*addSplit = add + forwardY;
+				return true;
+			}
+			if(backwardBest > 0 && backwardBest < n + m) {
+				*remSplit = rem + backwardX;
+				*addSplit = add + backwardY;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * \brief Append common runs of shortest edit script between \p rem and \p add to \p list.
+ */
+void
+MyersDiff::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	assert(rem <= remEnd);
+	assert(add <= addEnd);
+
+	// common prefix and suffix are part of every shortest path
+	int prefix = 0;
+	while(rem + prefix < remEnd && add + prefix < addEnd && rem[prefix] == add[prefix])
+		prefix++;
+	pushMatch(rem, add, prefix, list);
+	rem += prefix;
+	add += prefix;
+
+	int suffix = 0;
+	while(remEnd - suffix > rem && addEnd - suffix > add && remEnd[-suffix - 1] == addEnd[-suffix - 1])
+		suffix++;
+
+	const char *remSplit;
+	const char *addSplit;
+	if(rem < remEnd - suffix && add < addEnd - suffix
+		&& middleSnake(rem, remEnd - suffix, add, addEnd - suffix, &remSplit, &addSplit)) {
+		compareBlocks(rem, remSplit, add, addSplit, list);
+		compareBlocks(remSplit, remEnd - suffix, addSplit, addEnd - suffix, list);
+	}
+
+	pushMatch(remEnd - suffix, addEnd - suffix, suffix, list);
+}
@@ -0,0 +1,29 @@
+#ifndef MYERSDIFF_H
+#define MYERSDIFF_H
+
+#include "budget.h"
+#include "match.h"
+
+#include <vector>
+
+/*!
+ * \brief Myers' O(ND) difference algorithm, cost grows with size of the change instead of size of the blocks.
+ */
+class MyersDiff
+{
+public:
+	MyersDiff(Budget *budget = nullptr);
+
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+private:
+	bool middleSnake(const char *rem, const char *remEnd, const char *add, const char *addEnd,
+			const char **remSplit, const char **addSplit);
+	void pushMatch(const char *rem, const char *add, int len, MatchList &list);
+
+	Budget *budget_;
+	std::vector<int> forward_;
+	std::vector<int> backward_;
+};
+
+#endif // MYERSDIFF_H
@@ -29,6 +29,11 @@ int NeonApp::indentWidth_ = 0;
 const char *NeonApp::tabCharacter_ = " ";
 int NeonApp::tabWidth_ = 4;
 bool NeonApp::reparseRange_ = false;
+MatchEngine NeonApp::matchEngine_ = engineCache;
+bool NeonApp::alignLines_ = false;
+bool NeonApp::wordDiff_ = false;
+int NeonApp::budget_ = 0;
+bool NeonApp::stats_ = false;
 
 NeonApp::NeonApp(FILE *inputStream, FILE *outputStream)
 	: parser_(new DiffParser(inputStream)),
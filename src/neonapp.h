@@ -5,6 +5,15 @@
 
 class DiffParser;
 
+enum MatchEngine {
+	engineCache,
+	engineAutomaton,
+	engineSuffixArray,
+	engineMyers,
+	// picks one of above engines for each block, must stay last
+	engineAuto
+};
+
 class NeonApp
 {
 public:
@@ -23,15 +32,26 @@ public:
 	inline const char * tabCharacter() { return tabCharacter_; }
 	inline int tabWidth() { return tabWidth_; }
 	inline bool reparseRange() { return reparseRange_; }
+	inline MatchEngine matchEngine() { return matchEngine_; }
+	inline bool alignLines() { return alignLines_; }
+	inline bool wordDiff() { return wordDiff_; }
+	inline int budget() { return budget_; }
+	inline bool stats() { return stats_; }
 
 private:
 	friend int main(int argc, char *argv[]);
+	friend class TestOptions;
 
 	static bool ignoreSpaces_;
 	static int indentWidth_;
 	static const char *tabCharacter_;
 	static int tabWidth_;
 	static bool reparseRange_;
+	static MatchEngine matchEngine_;
+	static bool alignLines_;
+	static bool wordDiff_;
+	static int budget_;
+	static bool stats_;
 
 	DiffParser *parser_;
 
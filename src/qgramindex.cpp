@@ -0,0 +1,79 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "qgramindex.h"
+
+#include <algorithm>
+
+static_assert(QGRAM_SIZE == sizeof(uint32_t), "q-grams are packed into 32 bit words");
+
+/*!
+ * \brief Index all positions of \p add block.
+ * Hash table has at least twice as many slots as there are positions, colliding q-grams share chain.
+ */
+void
+QGramIndex::build(const char *add, const char *addEnd)
+{
+	const int len = addEnd - add;
+	const int gramCount = std::max(len - QGRAM_SIZE + 1, 0);
+
+	int bits = 1;
+	while((1 << bits) < 2 * gramCount)
+		bits++;
+	shift_ = 32 - bits;
+
+	std::fill(byteHead_, byteHead_ + 256, -1);
+	byteNext_.resize(len);
+	gramHead_.assign(1 << bits, -1);
+	gramNext_.resize(gramCount);
+	grams_.resize(gramCount);
+
+	// going backwards prepends positions, so chains end up in increasing order
+	for(int pos = len - 1; pos >= 0; pos--) {
+		int &head = byteHead_[static_cast<unsigned char>(add[pos])];
+		byteNext_[pos] = head;
+		head = pos;
+
+		if(pos < gramCount) {
+			grams_[pos] = gram(add + pos);
+			int &gramHead = gramHead_[slot(grams_[pos])];
+			gramNext_[pos] = gramHead;
+			gramHead = pos;
+		}
+	}
+}
+
+int
+QGramIndex::firstGram(uint32_t gram) const
+{
+	int pos = gramHead_[slot(gram)];
+	while(pos != -1 && grams_[pos] != gram)
+		pos = gramNext_[pos];
+	return pos;
+}
+
+int
+QGramIndex::nextGram(int pos, uint32_t gram) const
+{
+	do {
+		pos = gramNext_[pos];
+	} while(pos != -1 && grams_[pos] != gram);
+	return pos;
+}
@@ -0,0 +1,44 @@
+#ifndef QGRAMINDEX_H
+#define QGRAMINDEX_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define QGRAM_SIZE 4
+
+/*!
+ * \brief Positions of '+' block grouped by their first character and by their first QGRAM_SIZE characters.
+ * Positions of each group are chained in increasing order.
+ */
+class QGramIndex
+{
+public:
+	void build(const char *add, const char *addEnd);
+
+	static inline uint32_t gram(const char *pos)
+	{
+		uint32_t g;
+		memcpy(&g, pos, sizeof(g));
+		return g;
+	}
+
+	inline int firstByte(const char ch) const { return byteHead_[static_cast<unsigned char>(ch)]; }
+	inline int nextByte(int pos) const { return byteNext_[pos]; }
+
+	int firstGram(uint32_t gram) const;
+	int nextGram(int pos, uint32_t gram) const;
+
+private:
+	inline uint32_t slot(uint32_t gram) const { return (gram * 2654435761u) >> shift_; }
+
+	int byteHead_[256];
+	std::vector<int> byteNext_;
+
+	int shift_;
+	std::vector<int> gramHead_;
+	std::vector<int> gramNext_;
+	std::vector<uint32_t> grams_;
+};
+
+#endif // QGRAMINDEX_H
@@ -0,0 +1,364 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "suffixarray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+/*!
+ * \brief Build suffix array \p sa of \p n long \p text with values in [0, \p upper] using SA-IS algorithm in
+ * linear time. Temporary arrays are allocated from \p arena.
+ */
+static void
+buildSuffixArray(const int *text, int n, int upper, int *sa, Arena *arena)
+{
+	const ArenaAllocator<int> alloc(arena);
+	std::fill(sa, sa + n, -1);
+	if(n < 2) {
+		if(n)
+			sa[0] = 0;
+		return;
+	}
+
+	// type of each suffix: S (smaller than next suffix) or L (larger)
+	std::vector<bool, ArenaAllocator<bool>> typeS(n, false, alloc);
+	for(int i = n - 2; i >= 0; i--)
+		typeS[i] = text[i] == text[i + 1] ? typeS[i + 1] : text[i] < text[i + 1];
+
+	// bucket starts of S and L suffixes for each character
+	ArenaVector<int> sumL(upper + 2, 0, alloc);
+	ArenaVector<int> sumS(upper + 2, 0, alloc);
+	for(int i = 0; i < n; i++) {
+		if(!typeS[i])
+			sumS[text[i]]++;
+		else
+			sumL[text[i] + 1]++;
+	}
+	for(int i = 0; i <= upper; i++) {
+		sumS[i] += sumL[i];
+		sumL[i + 1] += sumS[i];
+	}
+
+	ArenaVector<int> bucket(upper + 2, 0, alloc);
+	auto induce = [&](const ArenaVector<int> &lms) {
+		std::fill(sa, sa + n, -1);
+		std::copy(sumS.begin(), sumS.end(), bucket.begin());
+		for(const int d : lms) {
+			if(d != n)
+				sa[bucket[text[d]]++] = d;
+		}
+		std::copy(sumL.begin(), sumL.end(), bucket.begin());
+		sa[bucket[text[n - 1]]++] = n - 1;
+		for(int i = 0; i < n; i++) {
+			const int v = sa[i];
+			if(v >= 1 && !typeS[v - 1])
+				sa[bucket[text[v - 1]]++] = v - 1;
+		}
+		std::copy(sumL.begin(), sumL.end(), bucket.begin());
+		for(int i = n - 1; i >= 0; i--) {
+			const int v = sa[i];
+			if(v >= 1 && typeS[v - 1])
+				sa[--bucket[text[v - 1] + 1]] = v - 1;
+		}
+	};
+
+	// leftmost S suffixes
+	ArenaVector<int> lmsIndex(n + 1, -1, alloc);
+	ArenaVector<int> lms(alloc);
+	lms.reserve(n / 2 + 1);
+	for(int i = 1; i < n; i++) {
+		if(!typeS[i - 1] && typeS[i]) {
+			lmsIndex[i] = lms.size();
+			lms.push_back(i);
+		}
+	}
+	const int m = lms.size();
+
+	induce(lms);
+
+	if(!m)
+		return;
+
+	// name LMS substrings and sort them recursively
+	ArenaVector<int> sortedLms(alloc);
+	sortedLms.reserve(m);
+	for(int i = 0; i < n; i++) {
+		if(lmsIndex[sa[i]] != -1)
+			sortedLms.push_back(sa[i]);
+	}
+	ArenaVector<int> lmsText(m, 0, alloc);
+	int lmsUpper = 0;
+	lmsText[lmsIndex[sortedLms[0]]] = 0;
+	for(int i = 1; i < m; i++) {
+		int left = sortedLms[i - 1];
+		int right = sortedLms[i];
+		const int leftEnd = lmsIndex[left] + 1 < m ? lms[lmsIndex[left] + 1] : n;
+		const int rightEnd = lmsIndex[right] + 1 < m ? lms[lmsIndex[right] + 1] : n;
+		bool same = true;
+		if(leftEnd - left != rightEnd - right) {
+			same = false;
+		} else {
+			while(left < leftEnd && text[left] == text[right]) {
+				left++;
+				right++;
+			}
+			if(left == n || text[left] != text[right])
+				same = false;
+		}
+		if(!same)
+			lmsUpper++;
+		lmsText[lmsIndex[sortedLms[i]]] = lmsUpper;
+	}
+
+	ArenaVector<int> lmsSa(m, 0, alloc);
+	buildSuffixArray(lmsText.data(), m, lmsUpper, lmsSa.data(), arena);
+	for(int i = 0; i < m; i++)
+		sortedLms[i] = lms[lmsSa[i]];
+	induce(sortedLms);
+}
+
+SuffixArray::SuffixArray(Arena *arena, Budget *budget)
+	: arena_(arena),
+	  budget_(budget),
+	  rem_(nullptr),
+	  remLen_(0),
+	  add_(nullptr),
+	  addLen_(0)
+{
+}
+
+/*!
+ * \brief Build suffix array and LCP of \p rem and \p add blocks separated by unique character.
+ * Separator suffix is left out, sa_ has suffixes of both blocks and lcp_[i] is common prefix of sa_[i] and sa_[i + 1].
+ */
+void
+SuffixArray::build(const char *rem, const char *remEnd, const char *add, const char *addEnd)
+{
+	assert(rem <= remEnd);
+	assert(add <= addEnd);
+
+	rem_ = rem;
+	remLen_ = remEnd - rem;
+	add_ = add;
+	addLen_ = addEnd - add;
+	const int n = remLen_ + 1 + addLen_;
+
+	// bytes are shifted by one, 0 is separator
+	text_.resize(n);
+	for(int i = 0; i < remLen_; i++)
+		text_[i] = static_cast<unsigned char>(rem[i]) + 1;
+	text_[remLen_] = 0;
+	for(int i = 0; i < addLen_; i++)
+		text_[remLen_ + 1 + i] = static_cast<unsigned char>(add[i]) + 1;
+
+	sa_.resize(n);
+	{
+		// temporaries of all recursion levels are released once array is built
+		const ArenaScope scope(arena_);
+		buildSuffixArray(text_.data(), n, 256, sa_.data(), arena_);
+	}
+
+	// Kasai's algorithm
+	rank_.resize(n);
+	for(int i = 0; i < n; i++)
+		rank_[sa_[i]] = i;
+	lcp_.assign(n - 1, 0);
+	int h = 0;
+	for(int i = 0; i < n; i++) {
+		if(h > 0)
+			h--;
+		if(rank_[i] == 0)
+			continue;
+		const int j = sa_[rank_[i] - 1];
+		while(i + h < n && j + h < n && text_[i + h] && text_[i + h] == text_[j + h])
+			h++;
+		lcp_[rank_[i] - 1] = h;
+	}
+
+	// separator is smallest suffix, it has no common prefix with the others
+	assert(sa_[0] == remLen_);
+	sa_.erase(sa_.begin());
+	if(!lcp_.empty())
+		lcp_.erase(lcp_.begin());
+}
+
+/*!
+ * \brief Add suffix of \p len characters to groups in \p stack (or no suffix when \p len is 0) and merge groups
+ * that have at least \p lcp common characters with next suffix.
+ */
+void
+SuffixArray::mergeGroups(std::vector<Group> &stack, int lcp, int len)
+{
+	while(!stack.empty() && stack.back().lcp_ >= lcp) {
+		len = std::max(len, stack.back().len_);
+		stack.pop_back();
+	}
+	if(!len)
+		return;
+	int best = std::min(lcp, len);
+	if(!stack.empty())
+		best = std::max(best, stack.back().best_);
+	stack.push_back(Group{lcp, len, best});
+}
+
+/*!
+ * \brief Find longest common substring of parts of blocks in \p range.
+ * When there are more matches of same length, first in '-' and then first in '+' block is returned.
+ */
+Match
+SuffixArray::longestMatch(const Range &range)
+{
+	// common prefix of two suffixes is minimum of lcp_ between them, cut by end of range parts
+	int bestLen = 0;
+	remGroups_.clear();
+	addGroups_.clear();
+	for(int i = range.first_; i < range.last_; i++) {
+		const int pos = sa_[i];
+		const bool isRem = pos < remLen_;
+		const int len = isRem ? range.remEnd_ - pos : range.addEnd_ - pos;
+		const std::vector<Group> &other = isRem ? addGroups_ : remGroups_;
+		if(!other.empty())
+			bestLen = std::max(bestLen, std::min(other.back().best_, len));
+		if(i + 1 == range.last_)
+			break;
+		mergeGroups(remGroups_, lcp_[i], isRem ? len : 0);
+		mergeGroups(addGroups_, lcp_[i], isRem ? 0 : len);
+	}
+	if(!bestLen)
+		return Match();
+
+	// suffixes starting with same bestLen characters are neighbours, find first ones of such groups
+	int bestRem = range.remEnd_;
+	int bestAdd = range.addEnd_;
+	for(int i = range.first_; i < range.last_; i++) {
+		int firstRem = range.remEnd_;
+		int firstAdd = range.addEnd_;
+		for(; i < range.last_; i++) {
+			const int pos = sa_[i];
+			if(pos < remLen_) {
+				if(range.remEnd_ - pos >= bestLen)
+					firstRem = std::min(firstRem, pos);
+			} else if(range.addEnd_ - pos >= bestLen) {
+				firstAdd = std::min(firstAdd, pos);
+			}
+			if(i + 1 == range.last_ || lcp_[i] < bestLen)
+				break;
+		}
+		if(firstRem < bestRem && firstAdd < range.addEnd_) {
+			bestRem = firstRem;
+			bestAdd = firstAdd;
+		}
+	}
+
+	const char *rem = rem_ + bestRem;
+	const char *add = add_ + bestAdd - remLen_ - 1;
+	return Match(rem, rem + bestLen, add, add + bestLen, bestLen);
+}
+
+/*!
+ * \brief Find longest common substring of built blocks.
+ */
+Match
+SuffixArray::longestMatch()
+{
+	return longestMatch(Range{0, remLen_, remLen_ + 1, remLen_ + 1 + addLen_, 0, static_cast<int>(sa_.size()), 0});
+}
+
+/*!
+ * \brief Push parts of \p range before and after \p match to pending_, with the match between them.
+ * Suffixes of each part are moved to its place in sa_, keeping their order, and lcp_ between them is updated.
+ */
+void
+SuffixArray::splitRange(const Range &range, const Match &match)
+{
+	const int rem = match.rem_ - rem_;
+	const int add = match.add_ - add_ + remLen_ + 1;
+	const bool hasLeft = range.rem_ < rem && range.add_ < add;
+	const bool hasRight = rem + match.len_ < range.remEnd_ && add + match.len_ < range.addEnd_;
+
+	// left suffixes are written over range start, right ones are collected in scratch
+	scratch_.resize(range.last_ - range.first_);
+	scratchLcp_.resize(range.last_ - range.first_);
+	int leftCount = 0;
+	int rightCount = 0;
+	int leftLcp = 0;
+	int rightLcp = 0;
+	for(int i = range.first_; i < range.last_; i++) {
+		const int pos = sa_[i];
+		const int start = pos < remLen_ ? rem : add;
+		if(hasLeft && pos < start) {
+			if(leftCount)
+				lcp_[range.first_ + leftCount - 1] = leftLcp;
+			sa_[range.first_ + leftCount++] = pos;
+			leftLcp = INT_MAX;
+		} else if(hasRight && pos >= start + match.len_) {
+			if(rightCount)
+				scratchLcp_[rightCount - 1] = rightLcp;
+			scratch_[rightCount++] = pos;
+			rightLcp = INT_MAX;
+		}
+		if(i + 1 < range.last_) {
+			leftLcp = std::min(leftLcp, lcp_[i]);
+			rightLcp = std::min(rightLcp, lcp_[i]);
+		}
+	}
+	const int middle = range.first_ + leftCount;
+	std::copy(scratch_.begin(), scratch_.begin() + rightCount, sa_.begin() + middle);
+	if(rightCount)
+		std::copy(scratchLcp_.begin(), scratchLcp_.begin() + rightCount - 1, lcp_.begin() + middle);
+
+	// pending_ is a stack, left part is matched first
+	if(hasRight)
+		pending_.push_back(Range{rem + match.len_, range.remEnd_, add + match.len_, range.addEnd_, middle, middle + rightCount, 0});
+	pending_.push_back(Range{rem, 0, add, 0, 0, 0, match.len_});
+	if(hasLeft)
+		pending_.push_back(Range{range.rem_, rem, range.add_, add, range.first_, middle, 0});
+}
+
+/*!
+ * \brief Append matching parts of \p rem and \p add to \p list, by matching around longest common substring.
+ * Suffix array is built once, parts around the match keep their suffixes and are searched the same way.
+ */
+void
+SuffixArray::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list)
+{
+	build(rem, remEnd, add, addEnd);
+
+	pending_.clear();
+	pending_.push_back(Range{0, remLen_, remLen_ + 1, remLen_ + 1 + addLen_, 0, static_cast<int>(sa_.size()), 0});
+	while(!pending_.empty()) {
+		const Range range = pending_.back();
+		pending_.pop_back();
+		if(range.len_) {
+			const char *matchRem = rem_ + range.rem_;
+			const char *matchAdd = add_ + range.add_ - remLen_ - 1;
+			list.push_back(Match(matchRem, matchRem + range.len_, matchAdd, matchAdd + range.len_, range.len_));
+			continue;
+		}
+		// found matches are still appended, remaining ranges are left unmatched
+		if(budget_ && budget_->exceeded())
+			continue;
+		const Match longest = longestMatch(range);
+		if(longest.len_)
+			splitRange(range, longest);
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef SUFFIXARRAY_H
+#define SUFFIXARRAY_H
+
+#include "arena.h"
+#include "budget.h"
+#include "match.h"
+
+#include <vector>
+
+/*!
+ * \brief Suffix array with LCP of '-' and '+' blocks joined together, finds longest common substrings in linear time.
+ */
+class SuffixArray
+{
+public:
+	SuffixArray(Arena *arena = nullptr, Budget *budget = nullptr);
+
+	void build(const char *rem, const char *remEnd, const char *add, const char *addEnd);
+	Match longestMatch();
+
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+private:
+	/*!
+	 * \brief Part of joined text, suffixes starting in it are sa_[first_, last_).
+	 * With non-zero len_ it is a found match starting at rem_ and add_ instead.
+	 */
+	struct Range {
+		int rem_;
+		int remEnd_;
+		int add_;
+		int addEnd_;
+		int first_;
+		int last_;
+		int len_;
+	};
+
+	/*!
+	 * \brief Suffixes of one block with common prefix lcp_ with current suffix, they are len_ long at most.
+	 * best_ is longest match with current suffix of this and all previous groups.
+	 */
+	struct Group {
+		int lcp_;
+		int len_;
+		int best_;
+	};
+
+	static void mergeGroups(std::vector<Group> &stack, int lcp, int len);
+	Match longestMatch(const Range &range);
+	void splitRange(const Range &range, const Match &match);
+
+	Arena *arena_;
+	Budget *budget_;
+	const char *rem_;
+	int remLen_;
+	const char *add_;
+	int addLen_;
+
+	std::vector<int> text_;
+	std::vector<int> sa_;
+	std::vector<int> rank_;
+	std::vector<int> lcp_;
+	std::vector<int> scratch_;
+	std::vector<int> scratchLcp_;
+	std::vector<Group> remGroups_;
+	std::vector<Group> addGroups_;
+	std::vector<Range> pending_;
+};
+
+#endif // SUFFIXARRAY_H
@@ -0,0 +1,170 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "suffixautomaton.h"
+
+#include <cassert>
+
+SuffixAutomaton::SuffixAutomaton(Budget *budget)
+	: budget_(budget),
+	  add_(nullptr)
+{
+}
+
+int
+SuffixAutomaton::transition(int state, unsigned char ch) const
+{
+	for(int e = states_[state].firstEdge; e != -1; e = edges_[e].next) {
+		if(edges_[e].ch == ch)
+			return edges_[e].target;
+	}
+	return -1;
+}
+
+void
+SuffixAutomaton::addTransition(int state, unsigned char ch, int target)
+{
+	edges_.push_back({ch, target, states_[state].firstEdge});
+	states_[state].firstEdge = edges_.size() - 1;
+}
+
+void
+SuffixAutomaton::setTransition(int state, unsigned char ch, int target)
+{
+	for(int e = states_[state].firstEdge; e != -1; e = edges_[e].next) {
+		if(edges_[e].ch == ch) {
+			edges_[e].target = target;
+			return;
+		}
+	}
+	addTransition(state, ch, target);
+}
+
+/*!
+ * \brief Build automaton of all substrings of \p add block.
+ */
+void
+SuffixAutomaton::build(const char *add, const char *addEnd)
+{
+	assert(add <= addEnd);
+
+	const int len = addEnd - add;
+	add_ = add;
+	states_.clear();
+	edges_.clear();
+	states_.reserve(2 * len + 1);
+	edges_.reserve(3 * len + 1);
+
+	states_.push_back({0, -1, -1, -1});
+	int last = 0;
+
+	for(int i = 0; i < len; i++) {
+		const unsigned char ch = add[i];
+		const int cur = states_.size();
+		states_.push_back({states_[last].len + 1, 0, i, -1});
+
+		int p = last;
+		while(p != -1 && transition(p, ch) == -1) {
+			addTransition(p, ch, cur);
+			p = states_[p].link;
+		}
+		if(p != -1) {
+			const int q = transition(p, ch);
+			if(states_[p].len + 1 == states_[q].len) {
+				states_[cur].link = q;
+			} else {
+				// clone q, so that states keep the same set of end positions
+				const int clone = states_.size();
+				states_.push_back({states_[p].len + 1, states_[q].link, states_[q].firstEnd, -1});
+				for(int e = states_[q].firstEdge; e != -1; e = edges_[e].next)
+					addTransition(clone, edges_[e].ch, edges_[e].target);
+				while(p != -1 && transition(p, ch) == q) {
+					setTransition(p, ch, clone);
+					p = states_[p].link;
+				}
+				states_[q].link = states_[cur].link = clone;
+			}
+		}
+		last = cur;
+	}
+}
+
+/*!
+ * \brief Find longest part of \p rem that is contained in built '+' block.
+ * When there are more matches of same length, first in \p rem and then first in '+' block is returned.
+ */
+Match
+SuffixAutomaton::longestMatch(const char *rem, const char *remEnd) const
+{
+	int state = 0;
+	int len = 0;
+	int bestLen = 0;
+	int bestRemEnd = 0;
+	int bestAddEnd = 0;
+
+	for(int i = 0; rem + i < remEnd; i++) {
+		const unsigned char ch = rem[i];
+		int next;
+		while((next = transition(state, ch)) == -1 && state) {
+			state = states_[state].link;
+			len = states_[state].len;
+		}
+		if(next == -1)
+			continue;
+		state = next;
+		len++;
+		if(len > bestLen) {
+			bestLen = len;
+			bestRemEnd = i + 1;
+			bestAddEnd = states_[state].firstEnd + 1;
+		}
+	}
+
+	if(!bestLen)
+		return Match();
+
+	const char *remMatch = rem + bestRemEnd - bestLen;
+	const char *addMatch = add_ + bestAddEnd - bestLen;
+	return Match(remMatch, remMatch + bestLen, addMatch, addMatch + bestLen, bestLen);
+}
+
+/*!
+ * \brief Append matching parts of \p rem and \p add to \p list, by recursing around longest common substring.
+ */
+void
+SuffixAutomaton::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd,
+		MatchList &list)
+{
+	if(budget_ && budget_->exceeded())
+		return;
+
+	// sub-blocks need automaton of their own part of '+' block
+	build(add, addEnd);
+
+	const Match longest = longestMatch(rem, remEnd);
+	if(!longest.len_)
+		return;
+
+	if(rem < longest.rem_ && add < longest.add_)
+		compareBlocks(rem, longest.rem_, add, longest.add_, list);
+	list.push_back(longest);
+	if(longest.remEnd_ < remEnd && longest.addEnd_ < addEnd)
+		compareBlocks(longest.remEnd_, remEnd, longest.addEnd_, addEnd, list);
+}
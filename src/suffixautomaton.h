@@ -0,0 +1,46 @@
+#ifndef SUFFIXAUTOMATON_H
+#define SUFFIXAUTOMATON_H
+
+#include "budget.h"
+#include "match.h"
+
+#include <vector>
+
+/*!
+ * \brief Suffix automaton of '+' block, finds longest common substrings in linear time.
+ */
+class SuffixAutomaton
+{
+public:
+	SuffixAutomaton(Budget *budget = nullptr);
+
+	void build(const char *add, const char *addEnd);
+	Match longestMatch(const char *rem, const char *remEnd) const;
+
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, MatchList &list);
+
+private:
+	int transition(int state, unsigned char ch) const;
+	void addTransition(int state, unsigned char ch, int target);
+	void setTransition(int state, unsigned char ch, int target);
+
+	struct State {
+		int len;
+		int link;
+		int firstEnd;
+		int firstEdge;
+	};
+
+	struct Edge {
+		unsigned char ch;
+		int target;
+		int next;
+	};
+
+	Budget *budget_;
+	const char *add_;
+	std::vector<State> states_;
+	std::vector<Edge> edges_;
+};
+
+#endif // SUFFIXAUTOMATON_H
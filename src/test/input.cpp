@@ -2,6 +2,10 @@
 #include "diffparser.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
 
 // https://github.com/catchorg/Catch2 - A modern, C++-native, header-only, test framework for unit-tests, TDD and BDD
 #define CATCH_CONFIG_MAIN
@@ -12,10 +16,88 @@ public:
 	TestParser() : DiffParser(nullptr) {}
 
 	using DiffParser::handlerForLine; // redeclare public
+	using DiffParser::matchLine;
+	using DiffParser::matchBlocks;
+	using DiffParser::matchCompacted;
+};
+
+// sets options of NeonApp for test, they are restored when it goes out of scope
+class TestOptions {
+public:
+	TestOptions(bool reparseRange)
+	{
+		NeonApp::reparseRange_ = reparseRange;
+	}
+
+	~TestOptions()
+	{
+		NeonApp::reparseRange_ = false;
+	}
 };
 
 NeonApp *app = nullptr;
 
+static std::string
+stripAnsi(const char *text)
+{
+	std::string plain;
+	while(*text) {
+		if(*text == '\33') { // skip ansi chars
+			while(*text && *text++ != 'm');
+			continue;
+		}
+		plain += *text++;
+	}
+	return plain;
+}
+
+// highlighted parts of colored text, each followed by '|', line ends are left out
+static std::string
+highlightedText(const char *text)
+{
+	std::string highlighted;
+	bool on = false;
+	while(*text) {
+		if(*text == '\33') {
+			const char *code = text + 2;
+			while(*text && *text++ != 'm');
+			if(!on && strncmp(code, "7m", 2) == 0) {
+				on = true;
+			} else if(on && strncmp(code, "27m", 3) == 0) {
+				on = false;
+				highlighted += '|';
+			}
+			continue;
+		}
+		if(on && *text != '\n')
+			highlighted += *text;
+		text++;
+	}
+	if(on)
+		highlighted += '|';
+	return highlighted;
+}
+
+// colored output of parsing whole \p inputStream
+static std::string
+parseInput(FILE *inputStream)
+{
+	char *output = nullptr;
+	size_t outputLen = 0;
+	FILE *outputStream = open_memstream(&output, &outputLen);
+
+	app = new NeonApp(nullptr, outputStream);
+	DiffParser *parser = new DiffParser(inputStream);
+	parser->processInput();
+	delete parser;
+	delete app;
+	app = nullptr;
+	fclose(outputStream);
+
+	const std::string text(output, outputLen);
+	free(output);
+	return text;
+}
 
 TEST_CASE("input lines are detected properly", "[DiffParser]") {
 	TestParser parser;
@@ -41,3 +123,152 @@ TEST_CASE("input lines are detected properly", "[DiffParser]") {
 		REQUIRE(false == parser.handlerForLine(lineAnsiMix, "---", sizeof(lineAnsiMix) - 2));
 	}
 }
+
+TEST_CASE("'-' lines after '+' block start new block", "[DiffParser]") {
+	const char input[] = "@@ -1,2 +1,2 @@\n-a1\n+b1\n-c1\n+d1\n";
+	FILE *inputStream = nullptr;
+
+	SECTION("mapped input") {
+		inputStream = tmpfile();
+		fwrite(input, 1, sizeof(input) - 1, inputStream);
+		rewind(inputStream);
+	}
+
+	SECTION("piped input") {
+		int fds[2];
+		REQUIRE(pipe(fds) == 0);
+		REQUIRE(write(fds[1], input, sizeof(input) - 1) == sizeof(input) - 1);
+		close(fds[1]);
+		inputStream = fdopen(fds[0], "r");
+	}
+
+	char *output = nullptr;
+	size_t outputLen = 0;
+	FILE *outputStream = open_memstream(&output, &outputLen);
+
+	app = new NeonApp(nullptr, outputStream);
+	DiffParser *parser = new DiffParser(inputStream);
+	parser->processInput();
+	delete parser;
+	delete app;
+	app = nullptr;
+	fclose(outputStream);
+	fclose(inputStream);
+
+	REQUIRE(stripAnsi(output) == input);
+	free(output);
+}
+
+TEST_CASE("line matcher finds same matches as match cache", "[DiffParser]") {
+	app = new NeonApp(nullptr, nullptr);
+	TestParser parser;
+
+	srand(7);
+	for(int i = 0; i < 500; i++) {
+		std::string rem;
+		std::string add;
+		const int remLen = 1 + rand() % 80;
+		const int addLen = 1 + rand() % 80;
+		for(int j = 0; j < remLen; j++)
+			rem += "ab =;"[rand() % 5];
+		for(int j = 0; j < addLen; j++)
+			add += "ab =;"[rand() % 5];
+
+		MatchList list;
+		REQUIRE(parser.matchLine(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list));
+		MatchList expected;
+		parser.matchBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), false, expected);
+		REQUIRE(list.size() == expected.size());
+		for(size_t j = 0; j < list.size(); j++) {
+			REQUIRE(list[j].rem_ == expected[j].rem_);
+			REQUIRE(list[j].add_ == expected[j].add_);
+			REQUIRE(list[j].len_ == expected[j].len_);
+		}
+	}
+
+	const std::string line(LINE_MATCHER_MAX_SIZE + 1, 'a');
+	MatchList list;
+	REQUIRE(!parser.matchLine(line.data(), line.data() + line.size(), line.data(), line.data() + 1, list));
+
+	delete app;
+	app = nullptr;
+}
+
+TEST_CASE("matches of compacted blocks are mapped back over white-space", "[DiffParser]") {
+	app = new NeonApp(nullptr, nullptr);
+	TestParser parser;
+
+	const std::string rem = "  foo( a,b )  x = 1 ;";
+	const std::string add = "foo(a , b)\ty= 1;";
+	MatchList list;
+	parser.matchCompacted(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+
+	REQUIRE(list.size() == 2);
+	// first match takes white-space before it too
+	REQUIRE(list[0].rem_ == rem.data());
+	REQUIRE(list[0].remEnd_ == rem.data() + 14);
+	REQUIRE(list[0].add_ == add.data());
+	REQUIRE(list[0].addEnd_ == add.data() + 11);
+	REQUIRE(list[0].len_ == 14);
+	// others only white-space after them
+	REQUIRE(list[1].rem_ == rem.data() + 16);
+	REQUIRE(list[1].remEnd_ == rem.data() + rem.size());
+	REQUIRE(list[1].add_ == add.data() + 12);
+	REQUIRE(list[1].addEnd_ == add.data() + add.size());
+	REQUIRE(list[1].len_ == 5);
+
+	delete app;
+	app = nullptr;
+}
+
+TEST_CASE("long runs of context lines are never highlighted with --reparse-range", "[DiffParser]") {
+	const TestOptions options(true);
+
+	SECTION("run of 4 lines is kept, moved line is not matched across it") {
+		const char input[] = "@@ -1,5 +1,5 @@\n-moved line of text\n c1\n c2\n c3\n c4\n+moved line of text\n";
+		FILE *inputStream = tmpfile();
+		fwrite(input, 1, sizeof(input) - 1, inputStream);
+		rewind(inputStream);
+		const std::string output = parseInput(inputStream);
+		fclose(inputStream);
+		REQUIRE(highlightedText(output.c_str()) == "moved line of text|moved line of text|");
+	}
+
+	SECTION("shorter run is matched like other lines") {
+		const char input[] = "@@ -1,3 +1,3 @@\n-moved line of text\n c1\n c2\n+moved line of text\n";
+		FILE *inputStream = tmpfile();
+		fwrite(input, 1, sizeof(input) - 1, inputStream);
+		rewind(inputStream);
+		const std::string output = parseInput(inputStream);
+		fclose(inputStream);
+		REQUIRE(highlightedText(output.c_str()) == "c1|c2|c1|c2|");
+	}
+}
+
+TEST_CASE("context run after '+' line without line end keeps line markers", "[DiffParser]") {
+	const TestOptions options(true);
+	// truncated escape sequence takes line end of "+new line" with it
+	const char input[] = "@@ -1,6 +1,6 @@\n-old line\n ctx1\n ctx2\n ctx3\n ctx4\n-old end\n"
+			"+new line\e[\n ctx1\n ctx2\n ctx3\n ctx4\n+new end\n";
+	FILE *inputStream = nullptr;
+
+	SECTION("mapped input") {
+		inputStream = tmpfile();
+		fwrite(input, 1, sizeof(input) - 1, inputStream);
+		rewind(inputStream);
+	}
+
+	SECTION("piped input") {
+		int fds[2];
+		REQUIRE(pipe(fds) == 0);
+		REQUIRE(write(fds[1], input, sizeof(input) - 1) == sizeof(input) - 1);
+		close(fds[1]);
+		inputStream = fdopen(fds[0], "r");
+	}
+
+	const std::string output = parseInput(inputStream);
+	fclose(inputStream);
+
+	REQUIRE(stripAnsi(output.c_str()) == "@@ -1,6 +1,6 @@\n-old line\n-ctx1\n-ctx2\n-ctx3\n-ctx4\n-old end\n"
+			"-ctx1\n-ctx2\n-ctx3\n-ctx4\n+ctx1\n+ctx2\n+ctx3\n+ctx4\n+new linectx1\n+ctx2\n+ctx3\n+ctx4\n+new end\n");
+}
@@ -0,0 +1,471 @@
+#include "arena.h"
+#include "bitlcs.h"
+#include "blocksketch.h"
+#include "budget.h"
+#include "commonlength.h"
+#include "diffparser.h"
+#include "linealignment.h"
+#include "lineanchors.h"
+#include "linematcher.h"
+#include "matchcache.h"
+#include "myersdiff.h"
+#include "neonapp.h"
+#include "suffixarray.h"
+#include "suffixautomaton.h"
+#include "tokenmatcher.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+#include "catch.hpp"
+
+class CacheParser : public DiffParser {
+public:
+	CacheParser() : DiffParser(nullptr) {}
+
+	using DiffParser::matchEngine;
+};
+
+// matches have to be in order, not overlapping and have same content on both sides
+static bool
+validMatches(const char *rem, const char *add, const MatchList &list)
+{
+	const char *remPos = rem;
+	const char *addPos = add;
+	for(const Match &m : list) {
+		if(m.rem_ < remPos || m.add_ < addPos || m.remEnd_ <= m.rem_ || m.addEnd_ <= m.add_)
+			return false;
+		if(m.remEnd_ - m.rem_ != m.addEnd_ - m.add_ || memcmp(m.rem_, m.add_, m.remEnd_ - m.rem_))
+			return false;
+		remPos = m.remEnd_;
+		addPos = m.addEnd_;
+	}
+	return remPos <= rem + strlen(rem) && addPos <= add + strlen(add);
+}
+
+static std::string
+matchedText(const MatchList &list)
+{
+	std::string text;
+	for(const Match &m : list)
+		text.append(m.rem_, m.remEnd_ - m.rem_).append("|");
+	return text;
+}
+
+TEST_CASE("suffix automaton finds longest common substrings", "[SuffixAutomaton]") {
+	SuffixAutomaton automaton;
+
+	SECTION("longest match is first in both blocks") {
+		const char rem[] = "xabcyabcd";
+		const char add[] = "abcdzabc";
+		automaton.build(add, add + strlen(add));
+		const Match m = automaton.longestMatch(rem, rem + strlen(rem));
+		REQUIRE(m.len_ == 4);
+		REQUIRE(m.rem_ == rem + 5);
+		REQUIRE(m.add_ == add);
+	}
+
+	SECTION("blocks are matched around longest match") {
+		const char rem[] = "int value = compute(a, b);\n";
+		const char add[] = "long value = computeAll(a, c);\n";
+		MatchList list;
+		automaton.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), list);
+		REQUIRE(validMatches(rem, add, list));
+		REQUIRE(matchedText(list) == "n| value = compute|(a, |);\n|");
+	}
+
+	SECTION("unrelated blocks have no matches") {
+		const char rem[] = "abc";
+		const char add[] = "xyz";
+		MatchList list;
+		automaton.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), list);
+		REQUIRE(list.empty());
+	}
+}
+
+TEST_CASE("suffix array finds same matches as suffix automaton", "[SuffixArray]") {
+	SuffixAutomaton automaton;
+	SuffixArray suffixArray;
+
+	srand(1);
+	for(int n = 0; n < 1000; n++) {
+		// small alphabet makes lots of equally long matches
+		std::string rem;
+		std::string add;
+		for(int i = rand() % 40; i > 0; i--)
+			rem += 'a' + rand() % 3;
+		for(int i = rand() % 40; i > 0; i--)
+			add += 'a' + rand() % 3;
+
+		MatchList automatonList;
+		automaton.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), automatonList);
+		MatchList suffixArrayList;
+		suffixArray.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), suffixArrayList);
+
+		REQUIRE(validMatches(rem.c_str(), add.c_str(), suffixArrayList));
+		REQUIRE(automatonList.size() == suffixArrayList.size());
+		for(auto i = automatonList.begin(), j = suffixArrayList.begin(); i != automatonList.end(); ++i, ++j) {
+			REQUIRE(i->rem_ == j->rem_);
+			REQUIRE(i->add_ == j->add_);
+			REQUIRE(i->len_ == j->len_);
+		}
+	}
+}
+
+TEST_CASE("myers diff finds longest common subsequence", "[MyersDiff]") {
+	MyersDiff myers;
+
+	SECTION("changed characters are not matched") {
+		const char rem[] = "abcabba";
+		const char add[] = "cbabac";
+		MatchList list;
+		myers.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), list);
+		REQUIRE(validMatches(rem, add, list));
+		int len = 0;
+		for(const Match &m : list)
+			len += m.len_;
+		REQUIRE(len == 4);
+	}
+
+	SECTION("touching runs are joined") {
+		const char rem[] = "same text, other text";
+		const char add[] = "same text, another text";
+		MatchList list;
+		myers.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), list);
+		REQUIRE(validMatches(rem, add, list));
+		REQUIRE(matchedText(list) == "same text, |other text|");
+	}
+
+	SECTION("dissimilar blocks are split at furthest reaching path") {
+		srand(1);
+		std::string rem;
+		std::string add;
+		for(int i = 0; i < 20000; i++) {
+			rem += 'a' + rand() % 4;
+			add += 'a' + rand() % 4;
+		}
+		MatchList list;
+		myers.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+		REQUIRE(validMatches(rem.c_str(), add.c_str(), list));
+		int len = 0;
+		for(const Match &m : list)
+			len += m.len_;
+		REQUIRE(len > 10000);
+	}
+}
+
+TEST_CASE("matchers stop when time budget is used up", "[Budget]") {
+	Budget budget;
+	budget.start(1);
+	while(!budget.exceeded())
+		;
+
+	const std::string rem = "first block with some text";
+	const std::string add = "other block with some words";
+	MatchList list;
+	MyersDiff myers(&budget);
+	myers.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+	REQUIRE(list.empty());
+	SuffixArray suffixArray(nullptr, &budget);
+	suffixArray.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+	REQUIRE(list.empty());
+	SuffixAutomaton automaton(&budget);
+	automaton.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+	REQUIRE(list.empty());
+
+	budget.start(0);
+	REQUIRE(!budget.exceeded());
+	myers.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+	REQUIRE(matchedText(list) == "r| block with some |");
+}
+
+TEST_CASE("bit-parallel LCS has same length as myers diff", "[BitLcs]") {
+	MyersDiff myers;
+	BitLcs bitLcs;
+
+	srand(2);
+	for(int n = 0; n < 500; n++) {
+		// blocks over 64 characters need more than one word
+		std::string rem;
+		std::string add;
+		for(int i = rand() % 200; i > 0; i--)
+			rem += 'a' + rand() % 4;
+		for(int i = rand() % 200; i > 0; i--)
+			add += 'a' + rand() % 4;
+
+		MatchList myersList;
+		myers.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), myersList);
+		MatchList bitLcsList;
+		bitLcs.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), bitLcsList);
+
+		REQUIRE(validMatches(rem.c_str(), add.c_str(), bitLcsList));
+		int myersLen = 0;
+		for(const Match &m : myersList)
+			myersLen += m.len_;
+		int bitLcsLen = 0;
+		for(const Match &m : bitLcsList)
+			bitLcsLen += m.len_;
+		REQUIRE(myersLen == bitLcsLen);
+	}
+}
+
+TEST_CASE("unique lines are used as anchors", "[LineAnchors]") {
+	LineAnchors lineAnchors;
+	std::vector<Match> anchors;
+
+	SECTION("repeated and reordered lines are skipped") {
+		const char rem[] = "a\nunique 1\nb\nunique 2\nrepeated\nrepeated\nunique 3\n";
+		const char add[] = "unique 1\nc\nunique 3\nrepeated\nunique 2\n";
+		lineAnchors.find(rem, rem + strlen(rem), add, add + strlen(add), false, anchors);
+		REQUIRE(anchors.size() == 2);
+		REQUIRE(std::string(anchors[0].rem_, anchors[0].remEnd_) == "unique 1\n");
+		REQUIRE(anchors[0].add_ == add);
+		REQUIRE(std::string(anchors[1].add_, anchors[1].addEnd_) == "unique 3\n");
+	}
+
+	SECTION("white-space can be ignored") {
+		const char rem[] = "x\n\tfoo(a, b);\n";
+		const char add[] = "y\nfoo(a,b);\n";
+		lineAnchors.find(rem, rem + strlen(rem), add, add + strlen(add), false, anchors);
+		REQUIRE(anchors.empty());
+		lineAnchors.find(rem, rem + strlen(rem), add, add + strlen(add), true, anchors);
+		REQUIRE(anchors.size() == 1);
+		REQUIRE(anchors[0].rem_ == rem + 2);
+		REQUIRE(anchors[0].add_ == add + 2);
+	}
+}
+
+TEST_CASE("changed lines are paired with most similar lines", "[LineAlignment]") {
+	LineAlignment lineAlignment;
+	std::vector<Match> pairs;
+
+	const char rem[] = "int count = 0;\nreturn result;\n";
+	const char add[] = "// new comment here\nint counter = 0;\nbool done = false;\nreturn results;\n";
+	REQUIRE(lineAlignment.align(rem, rem + strlen(rem), add, add + strlen(add), false, pairs));
+	REQUIRE(pairs.size() == 2);
+	REQUIRE(std::string(pairs[0].rem_, pairs[0].remEnd_) == "int count = 0;\n");
+	REQUIRE(std::string(pairs[0].add_, pairs[0].addEnd_) == "int counter = 0;\n");
+	REQUIRE(std::string(pairs[1].rem_, pairs[1].remEnd_) == "return result;\n");
+	REQUIRE(std::string(pairs[1].add_, pairs[1].addEnd_) == "return results;\n");
+}
+
+TEST_CASE("token matcher matches whole words", "[TokenMatcher]") {
+	TokenMatcher tokenMatcher;
+	MatchList list;
+
+	SECTION("changed words are not partially matched") {
+		const char rem[] = "int count = 0x10;\n";
+		const char add[] = "int counter = 0x1f;\n";
+		tokenMatcher.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), false, list);
+		REQUIRE(validMatches(rem, add, list));
+		REQUIRE(matchedText(list) == "int | = |;\n|");
+	}
+
+	SECTION("white-space can be ignored") {
+		const char rem[] = "foo(a, b);\n";
+		const char add[] = "foo(a,b);\n";
+		tokenMatcher.compareBlocks(rem, rem + strlen(rem), add, add + strlen(add), true, list);
+		REQUIRE(list.size() == 1);
+		REQUIRE(list.front().remEnd_ == rem + strlen(rem) - 1);
+	}
+
+	SECTION("re-indented lines are matched") {
+		std::string rem;
+		std::string add;
+		for(int i = 0; i < 5000; i++) {
+			const std::string line = "value_" + std::to_string(i) + " = (" + std::to_string(i % 10) + ");\n";
+			rem += line;
+			add += "  " + line;
+		}
+		tokenMatcher.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), false, list);
+		REQUIRE(validMatches(rem.c_str(), add.c_str(), list));
+		int len = 0;
+		for(const Match &m : list)
+			len += m.len_;
+		REQUIRE(len == static_cast<int>(rem.size()));
+	}
+}
+
+TEST_CASE("vectorized common length matches scalar one", "[CommonLength]") {
+	srand(11);
+	char a[200];
+	char b[200];
+	for(int n = 0; n < 500; n++) {
+		const int len = rand() % 200;
+		for(int i = 0; i < len; i++)
+			a[i] = b[i] = 'a' + rand() % 3;
+		const int diff = rand() % (len + 1);
+		if(diff < len)
+			b[diff] = 'z';
+		const int maxLen = rand() % (len + 1);
+
+		const int expected = commonLengthScalar(a, b, maxLen);
+		REQUIRE(expected == std::min(diff, maxLen));
+		REQUIRE(commonLength(a, b, maxLen) == expected);
+#ifdef COMMONLENGTH_X86
+		REQUIRE(commonLengthSse2(a, b, maxLen) == expected);
+		if(cpuHasAvx2())
+			REQUIRE(commonLengthAvx2(a, b, maxLen) == expected);
+#endif
+	}
+}
+
+TEST_CASE("match cache returns longest entries first", "[MatchCache]") {
+	const char text[] = "abcdefghijklmnop";
+	const char other[] = "abcdefghijklmnop";
+	MatchCache cache;
+	cache.add(text, text + 2, other, 2);
+	cache.add(text, text + 6, other, 6);
+	cache.add(text + 6, text + 10, other + 6, 4);
+	cache.add(text + 10, text + 14, other + 10, 4);
+
+	SECTION("equal lengths are tried from newest entry") {
+		REQUIRE(cache[cache.longest()].rem_ == text);
+		REQUIRE(cache[cache.longest()].add_ == other);
+		cache.erase(cache.longest());
+		REQUIRE(cache[cache.longest()].rem_ == text + 10);
+		cache.erase(cache.longest());
+		REQUIRE(cache[cache.longest()].rem_ == text + 6);
+		REQUIRE(cache[cache.longest()].add_ == other + 6);
+	}
+
+	SECTION("clipped entries are split and shortened") {
+		cache.clip(text + 3, text + 8);
+		REQUIRE(cache[cache.longest()].rem_ == text + 10);
+		REQUIRE(cache[cache.longest()].add_ == other + 10);
+		cache.erase(cache.longest());
+		REQUIRE(cache[cache.longest()].rem_ == text);
+		REQUIRE(cache[cache.longest()].remEnd_ == text + 3);
+		REQUIRE(cache[cache.longest()].add_ == nullptr);
+		cache.erase(cache.longest());
+		REQUIRE(cache[cache.longest()].rem_ == text + 8);
+		REQUIRE(cache[cache.longest()].len_ == 2);
+		REQUIRE(cache[cache.longest()].add_ == nullptr);
+		cache.erase(cache.longest());
+		REQUIRE(cache[cache.longest()].len_ == 2);
+		cache.erase(cache.longest());
+		REQUIRE(cache.longest() == -1);
+	}
+}
+
+TEST_CASE("match cache skips runs with same matches as byte-by-byte extension", "[MatchCache]") {
+	app = new NeonApp(nullptr, nullptr);
+	CacheParser parser;
+
+	// closing braces, indentation and words, runs on '+' side are often of other length
+	const char chars[] = "}\t a\n";
+	srand(19);
+	for(int i = 0; i < 500; i++) {
+		// '+' blocks below and above q-gram index size
+		const size_t maxSize = i % 2 ? 60 : LINE_MATCHER_MAX_SIZE;
+		std::string rem;
+		std::string add;
+		while(rem.size() + 24 < maxSize && add.size() + 24 < maxSize) {
+			const char ch = chars[rand() % 5];
+			const int len = 1 + rand() % 12;
+			rem.append(len, ch);
+			add.append(rand() % 3 ? std::max(1, len + rand() % 7 - 3) : len, ch);
+			if(!(rand() % 8))
+				add += 'b';
+		}
+
+		MatchList expected;
+		REQUIRE(LineMatcher::compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), expected));
+		MatchList list;
+		parser.matchEngine(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+		REQUIRE(list.size() == expected.size());
+		for(size_t j = 0; j < list.size(); j++) {
+			REQUIRE(list[j].rem_ == expected[j].rem_);
+			REQUIRE(list[j].add_ == expected[j].add_);
+			REQUIRE(list[j].len_ == expected[j].len_);
+		}
+	}
+
+	delete app;
+	app = nullptr;
+}
+
+TEST_CASE("arena memory is reused after reset", "[Arena]") {
+	Arena arena;
+	char *first = static_cast<char *>(arena.allocate(10));
+	REQUIRE(reinterpret_cast<uintptr_t>(first) % 16 == 0);
+	REQUIRE(static_cast<char *>(arena.allocate(10)) == first + 16);
+
+	// bigger than first chunk, reset merges chunks into one
+	arena.allocate(100000);
+	arena.reset();
+	char *merged = static_cast<char *>(arena.allocate(100000));
+	REQUIRE(static_cast<char *>(arena.allocate(1000)) == merged + 100000);
+
+	ArenaVector<int> values{ArenaAllocator<int>(&arena)};
+	for(int i = 0; i < 1000; i++)
+		values.push_back(i);
+	REQUIRE(values[999] == 999);
+
+	// chunks added inside scope are freed when it ends
+	const size_t size = arena.size();
+	char *next = static_cast<char *>(arena.allocate(16));
+	{
+		const ArenaScope scope(&arena);
+		arena.allocate(1000000);
+	}
+	REQUIRE(arena.size() == size);
+	REQUIRE(static_cast<char *>(arena.allocate(16)) == next + 16);
+
+	// memory of huge hunk isn't kept after reset
+	arena.allocate(32 << 20);
+	arena.reset();
+	REQUIRE(arena.size() <= size);
+}
+
+TEST_CASE("suffix array releases build memory", "[SuffixArray]") {
+	Arena arena;
+	SuffixArray suffixArray(&arena);
+
+	// repetitive text makes deep recursion of suffix array construction
+	std::string rem;
+	std::string add;
+	srand(1);
+	for(int i = 0; i < 200000; i++) {
+		rem += 'a' + rand() % 2;
+		add += 'a' + rand() % 2;
+	}
+	for(int n = 0; n < 3; n++) {
+		MatchList list;
+		suffixArray.compareBlocks(rem.data(), rem.data() + rem.size(), add.data(), add.data() + add.size(), list);
+		REQUIRE(validMatches(rem.c_str(), add.c_str(), list));
+		REQUIRE(arena.size() == 0);
+	}
+}
+
+TEST_CASE("block sketch estimates similarity", "[BlockSketch]") {
+	BlockSketch sketch;
+	const std::string text = "int value = compute(first, second);\nreturn value * 2;\n";
+	const std::string other = "for(auto &item : items) {\n\tprocess(item);\n}\n";
+
+	sketch.compare(text.data(), text.data() + text.size(), text.data(), text.data() + text.size());
+	REQUIRE(sketch.similarity() == 1.f);
+	sketch.compare(text.data(), text.data() + text.size(), other.data(), other.data() + other.size());
+	REQUIRE(sketch.similarity() < 0.2f);
+	REQUIRE(sketch.containment() < 0.2f);
+	sketch.compare(text.data(), text.data() + 3, text.data(), text.data() + text.size());
+	REQUIRE(sketch.containment() == 0.f);
+
+	// part of block is contained whole
+	sketch.compare(text.data(), text.data() + 20, text.data(), text.data() + text.size());
+	REQUIRE(sketch.similarity() < 0.5f);
+	REQUIRE(sketch.containment() == 1.f);
+
+	// big blocks are sampled, similarity stays close
+	std::string big;
+	std::string changed;
+	for(int i = 0; i < 5000; i++) {
+		big += "line " + std::to_string(i) + "\n";
+		changed += "line " + std::to_string(i % 10 ? i : i + 7) + "\n";
+	}
+	sketch.compare(big.data(), big.data() + big.size(), changed.data(), changed.data() + changed.size());
+	REQUIRE(sketch.similarity() > 0.8f);
+	REQUIRE(sketch.similarity() < 1.f);
+}
@@ -0,0 +1,265 @@
+/*
+	neon-diff - Application to colorify, highlight and beautify unified diffs.
+
+	Copyright (C) 2018 - Mladen Milinkovic <maxrd2@smoothware.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "tokenmatcher.h"
+
+#include "characters.h"
+
+#include <string.h>
+#include <algorithm>
+
+enum CharClass {
+	classSpace,
+	classNewLine,
+	classWord,
+	classDigit,
+	classPunctuation
+};
+
+static inline CharClass
+charClass(const char ch)
+{
+	const unsigned char c = ch;
+	if(c == ' ' || c == '\t')
+		return classSpace;
+	if(c == '\n')
+		return classNewLine;
+	if(c >= '0' && c <= '9')
+		return classDigit;
+	// bytes of multibyte characters are part of words, so characters are never split
+	if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80)
+		return classWord;
+	return classPunctuation;
+}
+
+TokenMatcher::TokenMatcher(Arena *arena, Budget *budget)
+	: arena_(arena),
+	  budget_(budget)
+{
+}
+
+int
+TokenMatcher::intern(IdMap &ids, const char *start, const char *end)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for(const char *ch = start; ch < end; ch++)
+		hash = (hash ^ static_cast<unsigned char>(*ch)) * 1099511628211ULL;
+
+	IdMap::iterator it = ids.find(hash);
+	int last = -1;
+	if(it != ids.end()) {
+		for(int id = it->second; id != -1; id = idNext_[id]) {
+			const Token &token = idTokens_[id];
+			if(token.end - token.start == end - start && memcmp(token.start, start, end - start) == 0)
+				return id;
+			last = id;
+		}
+	}
+
+	// new token, chained after tokens with colliding hash
+	const int id = idTokens_.size();
+	if(last == -1)
+		ids[hash] = id;
+	else
+		idNext_[last] = id;
+	idTokens_.push_back({start, end, id});
+	idNext_.push_back(-1);
+	return id;
+}
+
+/*!
+ * \brief Split block into tokens, white-space is left out when ignoring it.
+ * Numbers continue with letters and dots, so 0x1f or 1.5e3 are single tokens.
+ */
+void
+TokenMatcher::tokenize(const char *block, const char *blockEnd, bool ignoreSpaces, IdMap &ids, std::vector<Token> &tokens)
+{
+	tokens.clear();
+	while(block < blockEnd) {
+		const char *start = block;
+		const CharClass cls = charClass(*block++);
+		switch(cls) {
+		case classSpace:
+			while(block < blockEnd && charClass(*block) == classSpace)
+				block++;
+			break;
+		case classWord:
+			while(block < blockEnd && (charClass(*block) == classWord || charClass(*block) == classDigit))
+				block++;
+			break;
+		case classDigit:
+			while(block < blockEnd && (charClass(*block) == classWord || charClass(*block) == classDigit || *block == '.'))
+				block++;
+			break;
+		default:
+			break;
+		}
+		if(ignoreSpaces && isSpace(*start))
+			continue;
+		tokens.push_back({start, block, intern(ids, start, block)});
+	}
+}
+
+bool
+TokenMatcher::Run::operator<(const Run &other) const
+{
+	if(weight != other.weight)
+		return weight < other.weight;
+	if(remLast != other.remLast)
+		return remLast > other.remLast;
+	return addLast > other.addLast;
+}
+
+TokenMatcher::Run
+TokenMatcher::makeRun(int rem, int add, int length) const
+{
+	return Run{remWeight_[rem + length] - remWeight_[rem], rem + length - 1, add + length - 1, length};
+}
+
+/*!
+ * \brief Append longest common run of tokens to \p list, then match parts before and after it the same way.
+ * Runs are found once and kept in a heap, a run popped from it is either whole in one of the parts that are
+ * left to match, so it's longest run there, or it's cut to those parts and pushed back.
+ * Once time budget is used up, parts that are left stay unmatched.
+ */
+void
+TokenMatcher::compareTokens(int rem, int remEnd, int add, int addEnd, MatchList &list)
+{
+	if(rem >= remEnd || add >= addEnd)
+		return;
+
+	idFirst_.assign(idTokens_.size(), -1);
+	addNext_.resize(addEnd);
+	for(int j = addEnd - 1; j >= add; j--) {
+		addNext_[j] = idFirst_[addTokens_[j].id];
+		idFirst_[addTokens_[j].id] = j;
+	}
+	remWeight_.resize(remEnd + 1);
+	remWeight_[rem] = 0;
+	for(int i = rem; i < remEnd; i++)
+		remWeight_[i + 1] = remWeight_[i] + (remTokens_[i].end - remTokens_[i].start);
+
+	// like match cache of characters, only runs longer than previous ones of same '-' token are kept
+	// and next '-' token is the one after longest of them
+	runs_.clear();
+	for(int i = rem, steps = 1; i < remEnd; steps++) {
+		if(budget_ && !(steps % BUDGET_CHECK_STEPS) && budget_->exceeded())
+			break;
+
+		int maxWeight = 0;
+		int maxLength = 0;
+		for(int j = idFirst_[remTokens_[i].id]; j != -1; j = addNext_[j]) {
+			int length = 1;
+			while(i + length < remEnd && j + length < addEnd && remTokens_[i + length].id == addTokens_[j + length].id)
+				length++;
+			const Run run = makeRun(i, j, length);
+			if(run.weight > maxWeight) {
+				runs_.push_back(run);
+				maxWeight = run.weight;
+				maxLength = length;
+			}
+		}
+		i += maxLength ? maxLength : 1;
+	}
+	std::make_heap(runs_.begin(), runs_.end());
+
+	RangeMap ranges{RangeMap::allocator_type(arena_)};
+	ranges[rem] = Range{remEnd, add, addEnd};
+	const size_t listStart = list.size();
+	for(int steps = 1; !runs_.empty() && !ranges.empty(); steps++) {
+		if(budget_ && !(steps % BUDGET_CHECK_STEPS) && budget_->exceeded())
+			break;
+
+		std::pop_heap(runs_.begin(), runs_.end());
+		const Run run = runs_.back();
+		runs_.pop_back();
+		const int runRem = run.remLast - run.length + 1;
+		const int diagonal = run.addLast - run.remLast;
+
+		RangeMap::iterator it = ranges.upper_bound(runRem);
+		if(it != ranges.begin())
+			--it;
+		const Range &range = it->second;
+		if(it->first <= runRem && run.remLast < range.remEnd && runRem + diagonal >= range.add && run.addLast < range.addEnd) {
+			list.push_back(Match(remTokens_[runRem].start, remTokens_[run.remLast].end,
+					addTokens_[runRem + diagonal].start, addTokens_[run.addLast].end, run.weight));
+			const int rangeRem = it->first;
+			const Range whole = range;
+			ranges.erase(it);
+			if(rangeRem < runRem && whole.add < runRem + diagonal)
+				ranges[rangeRem] = Range{runRem, whole.add, runRem + diagonal};
+			if(run.remLast + 1 < whole.remEnd && run.addLast + 1 < whole.addEnd)
+				ranges[run.remLast + 1] = Range{whole.remEnd, run.addLast + 1, whole.addEnd};
+			continue;
+		}
+
+		for(; it != ranges.end() && it->first <= run.remLast; ++it) {
+			const int first = std::max(std::max(runRem, it->first), it->second.add - diagonal);
+			const int last = std::min(std::min(run.remLast, it->second.remEnd - 1), it->second.addEnd - 1 - diagonal);
+			if(first > last)
+				continue;
+			runs_.push_back(makeRun(first, first + diagonal, last - first + 1));
+			std::push_heap(runs_.begin(), runs_.end());
+		}
+	}
+
+	std::sort(list.begin() + listStart, list.end(), [](const Match &a, const Match &b) {
+		return a.rem_ < b.rem_;
+	});
+}
+
+/*!
+ * \brief Append matching runs of tokens of \p rem and \p add blocks to \p list.
+ */
+void
+TokenMatcher::compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd,
+		bool ignoreSpaces, MatchList &list)
+{
+	IdMap ids(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), IdMap::allocator_type(arena_));
+	idTokens_.clear();
+	idNext_.clear();
+
+	tokenize(rem, remEnd, ignoreSpaces, ids, remTokens_);
+	tokenize(add, addEnd, ignoreSpaces, ids, addTokens_);
+
+	// common leading and trailing tokens are matched without searching
+	int remFirst = 0;
+	int addFirst = 0;
+	const int remCount = remTokens_.size();
+	const int addCount = addTokens_.size();
+	while(remFirst < remCount && addFirst < addCount && remTokens_[remFirst].id == addTokens_[addFirst].id) {
+		remFirst++;
+		addFirst++;
+	}
+	int remLast = remCount;
+	int addLast = addCount;
+	while(remLast > remFirst && addLast > addFirst && remTokens_[remLast - 1].id == addTokens_[addLast - 1].id) {
+		remLast--;
+		addLast--;
+	}
+
+	if(remFirst)
+		list.push_back(Match(remTokens_[0].start, remTokens_[remFirst - 1].end,
+				addTokens_[0].start, addTokens_[addFirst - 1].end, remTokens_[remFirst - 1].end - remTokens_[0].start));
+	compareTokens(remFirst, remLast, addFirst, addLast, list);
+	if(remLast < remCount)
+		list.push_back(Match(remTokens_[remLast].start, remTokens_[remCount - 1].end,
+				addTokens_[addLast].start, addTokens_[addCount - 1].end, remTokens_[remCount - 1].end - remTokens_[remLast].start));
+}
@@ -0,0 +1,79 @@
+#ifndef TOKENMATCHER_H
+#define TOKENMATCHER_H
+
+#include "arena.h"
+#include "budget.h"
+#include "match.h"
+
+#include <map>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * \brief Matches blocks word by word (--word-diff).
+ * Blocks are split into identifiers, numbers, white-space runs and punctuation, equal tokens share
+ * same integer id, and longest common runs of token ids are matched instead of single characters.
+ */
+class TokenMatcher
+{
+public:
+	TokenMatcher(Arena *arena = nullptr, Budget *budget = nullptr);
+
+	void compareBlocks(const char *rem, const char *remEnd, const char *add, const char *addEnd, bool ignoreSpaces,
+			MatchList &list);
+
+private:
+	struct Token {
+		const char *start;
+		const char *end;
+		int id;
+	};
+
+	/*!
+	 * \brief Common run of tokens ending at '-' token remLast and '+' token addLast.
+	 * Runs are ordered by weight, their length in characters, ties are resolved by earliest '-' and then '+' end.
+	 */
+	struct Run {
+		int weight;
+		int remLast;
+		int addLast;
+		int length;
+
+		bool operator<(const Run &other) const;
+	};
+
+	/*!
+	 * \brief Part of blocks that is left to match, its '-' tokens start at map key.
+	 */
+	struct Range {
+		int remEnd;
+		int add;
+		int addEnd;
+	};
+
+	typedef std::unordered_map<uint64_t, int, std::hash<uint64_t>, std::equal_to<uint64_t>,
+			ArenaAllocator<std::pair<const uint64_t, int>>> IdMap;
+	typedef std::map<int, Range, std::less<int>, ArenaAllocator<std::pair<const int, Range>>> RangeMap;
+
+	void tokenize(const char *block, const char *blockEnd, bool ignoreSpaces, IdMap &ids, std::vector<Token> &tokens);
+	int intern(IdMap &ids, const char *start, const char *end);
+	Run makeRun(int rem, int add, int length) const;
+	void compareTokens(int rem, int remEnd, int add, int addEnd, MatchList &list);
+
+	std::vector<Token> remTokens_;
+	std::vector<Token> addTokens_;
+	Arena *arena_;
+	Budget *budget_;
+	// first occurrence of each id and next id with same hash
+	std::vector<Token> idTokens_;
+	std::vector<int> idNext_;
+	// next '+' token with same id, first '+' token of each id
+	std::vector<int> addNext_;
+	std::vector<int> idFirst_;
+	// remWeight_[i] is length of '-' tokens before token i
+	std::vector<int> remWeight_;
+	std::vector<Run> runs_;
+};
+
+#endif // TOKENMATCHER_H